@@ -0,0 +1,590 @@
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "benchmark_positions.h"
+#include "book.h"
+#include "eval.h"
+#include "reversi.h"
+
+// Microbenchmarks of Board and Game primitives, the evaluation and book probes over the benchmark positions and every
+// position on the way to them. Each benchmark repeats until it ran for the minimum time and reports per-operation
+// time, heap allocations and, where the kernel allows perf events, retired instructions.
+
+std::atomic<std::uint64_t> allocation_count{0};
+
+// Every allocation function is replaced so aligned and nothrow allocations are counted too, the array forms call
+// these
+void *counted_allocation(std::size_t size, std::size_t alignment) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    size = size == 0 ? 1 : size;
+
+    if (alignment <= alignof(std::max_align_t)) {
+        return std::malloc(size);
+    }
+
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+// Not inlined into the replaced operator delete, GCC would otherwise warn about free after operator new
+__attribute__((noinline)) void release_allocation(void *memory) {
+    std::free(memory);
+}
+
+void *operator new(std::size_t size) {
+    if (auto memory = counted_allocation(size, alignof(std::max_align_t))) {
+        return memory;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    if (auto memory = counted_allocation(size, static_cast<std::size_t>(alignment))) {
+        return memory;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return counted_allocation(size, alignof(std::max_align_t));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return counted_allocation(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *memory) noexcept {
+    release_allocation(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    release_allocation(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+    release_allocation(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept {
+    release_allocation(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+    release_allocation(memory);
+}
+
+void operator delete(void *memory, std::align_val_t, const std::nothrow_t &) noexcept {
+    release_allocation(memory);
+}
+
+
+template<typename T>
+inline void do_not_optimize(const T &value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile T sink;
+    sink = value;
+#endif
+}
+
+
+class InstructionCounter {
+public:
+    InstructionCounter() {
+#ifdef __linux__
+        perf_event_attr attributes{};
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof(attributes);
+        attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+
+        _fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+    }
+
+    ~InstructionCounter() {
+#ifdef __linux__
+        if (_fd >= 0) {
+            close(_fd);
+        }
+#endif
+    }
+
+    InstructionCounter(const InstructionCounter &) = delete;
+
+    InstructionCounter &operator=(const InstructionCounter &) = delete;
+
+    [[nodiscard]] bool available() const {
+        return _fd >= 0;
+    }
+
+    void start() {
+#ifdef __linux__
+        if (_fd >= 0) {
+            ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    std::optional<std::uint64_t> stop() {
+#ifdef __linux__
+        if (_fd >= 0) {
+            ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+            std::uint64_t count = 0;
+
+            if (read(_fd, &count, sizeof(count)) == sizeof(count)) {
+                return count;
+            }
+        }
+#endif
+        return std::nullopt;
+    }
+
+private:
+    int _fd{-1};
+};
+
+
+struct BenchmarkResult {
+    std::string name;
+    std::uint64_t operations{0};
+    double nanoseconds_per_operation{0};
+    double allocations_per_operation{0};
+    std::optional<double> instructions_per_operation{};
+};
+
+struct Options {
+    double min_seconds{0.5};
+    std::string filter{};
+    std::string json_path{};
+};
+
+
+class BenchmarkRunner {
+public:
+    explicit BenchmarkRunner(Options options) : _options{std::move(options)} {}
+
+    // body runs one pass over the corpus and returns how many operations that pass was
+    [[nodiscard]] bool selected(const std::string &name) const {
+        return name.find(_options.filter) != std::string::npos;
+    }
+
+    template<typename Body>
+    void run(const std::string &name, Body &&body) {
+        if (!selected(name)) {
+            return;
+        }
+
+        // Warm up caches and branch predictors before measuring
+        body();
+
+        std::uint64_t passes = 1;
+
+        while (true) {
+            std::uint64_t operations = 0;
+            auto allocations = allocation_count.load(std::memory_order_relaxed);
+            _instructions.start();
+            auto start = std::chrono::steady_clock::now();
+
+            for (std::uint64_t i = 0; i < passes; i++) {
+                operations += body();
+            }
+
+            auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            auto instructions = _instructions.stop();
+            allocations = allocation_count.load(std::memory_order_relaxed) - allocations;
+
+            if (seconds >= _options.min_seconds) {
+                auto result = BenchmarkResult{
+                    .name = name,
+                    .operations = operations,
+                    .nanoseconds_per_operation = seconds * 1e9 / static_cast<double>(operations),
+                    .allocations_per_operation = static_cast<double>(allocations) / static_cast<double>(operations),
+                };
+
+                if (instructions.has_value()) {
+                    result.instructions_per_operation =
+                        static_cast<double>(*instructions) / static_cast<double>(operations);
+                }
+
+                print(result);
+                _results.push_back(result);
+                return;
+            }
+
+            // Aim a little past the minimum time so the next round is normally the last
+            auto scale = seconds > 0 ? 1.4 * _options.min_seconds / seconds : 10.0;
+            auto scaled = static_cast<std::uint64_t>(static_cast<double>(passes) * std::min(scale, 10.0));
+            passes = std::max(passes + 1, scaled);
+        }
+    }
+
+    void print_header() const {
+        std::printf("%-32s %14s %12s %14s %14s\n", "benchmark", "operations", "ns/op", "allocs/op", "instr/op");
+    }
+
+    [[nodiscard]] bool write_json() const {
+        if (_options.json_path.empty()) {
+            return true;
+        }
+
+        std::ofstream file{_options.json_path};
+
+        if (!file) {
+            return false;
+        }
+
+        file << "{\n  \"benchmarks\": [\n";
+
+        for (std::size_t i = 0; i < _results.size(); i++) {
+            const auto &result = _results[i];
+            file << "    {\"name\": \"" << result.name << "\", \"operations\": " << result.operations
+                 << ", \"ns_per_op\": " << result.nanoseconds_per_operation
+                 << ", \"allocations_per_op\": " << result.allocations_per_operation << ", \"instructions_per_op\": ";
+
+            if (result.instructions_per_operation.has_value()) {
+                file << *result.instructions_per_operation;
+            } else {
+                file << "null";
+            }
+
+            file << "}" << (i + 1 < _results.size() ? "," : "") << "\n";
+        }
+
+        file << "  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+
+private:
+    static void print(const BenchmarkResult &result) {
+        char instructions[32] = "n/a";
+
+        if (result.instructions_per_operation.has_value()) {
+            std::snprintf(instructions, sizeof(instructions), "%.1f", *result.instructions_per_operation);
+        }
+
+        std::printf(
+            "%-32s %14llu %12.2f %14.3f %14s\n",
+            result.name.c_str(),
+            static_cast<unsigned long long>(result.operations),
+            result.nanoseconds_per_operation,
+            result.allocations_per_operation,
+            instructions
+        );
+        std::fflush(stdout);
+    }
+
+    Options _options;
+    InstructionCounter _instructions{};
+    std::vector<BenchmarkResult> _results{};
+};
+
+
+// Removes the file at path when it goes out of scope
+class TemporaryFile {
+public:
+    explicit TemporaryFile(std::filesystem::path path) : _path{std::move(path)} {}
+
+    TemporaryFile(const TemporaryFile &) = delete;
+
+    TemporaryFile &operator=(const TemporaryFile &) = delete;
+
+    ~TemporaryFile() {
+        std::error_code error;
+        std::filesystem::remove(_path, error);
+    }
+
+    [[nodiscard]] const std::filesystem::path &path() const {
+        return _path;
+    }
+
+private:
+    std::filesystem::path _path;
+};
+
+
+struct Position {
+    Game game;
+    std::vector<Move> moves;
+};
+
+// Every position from move 10 on along the benchmark lines, with its legal moves
+std::vector<Position> load_corpus() {
+    std::vector<Position> corpus;
+
+    for (auto line: benchmark_positions) {
+        Game game;
+
+        for (std::size_t i = 0; i < line.size(); i += 2) {
+            if (!play_moves(game, line.substr(i, 2))) {
+                std::cerr << "Invalid benchmark position " << line << std::endl;
+                std::exit(1);
+            }
+
+            if (game.move_count() < 10) {
+                continue;
+            }
+
+            auto position = Position{.game = game, .moves = {}};
+
+            for (auto moves = game.board().legal_moves(game.current_turn()); moves != 0; moves &= moves - 1) {
+                auto square = std::countr_zero(moves);
+                position.moves.push_back(Move{.piece = game.current_turn(), .row = square / 8, .column = square % 8});
+            }
+
+            corpus.push_back(position);
+        }
+    }
+
+    return corpus;
+}
+
+bool parse_options(int argc, char *argv[], Options &options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        auto option = std::string{argv[i]};
+
+        try {
+            if (option == "--min-time") {
+                options.min_seconds = std::stod(argv[i + 1]);
+            } else if (option == "--filter") {
+                options.filter = argv[i + 1];
+            } else if (option == "--json") {
+                options.json_path = argv[i + 1];
+            } else {
+                return false;
+            }
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    return argc % 2 == 1;
+}
+
+int main(int argc, char *argv[]) {
+    auto options = Options{};
+
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--min-time <seconds>] [--filter <name part>] [--json <path>]"
+                  << std::endl;
+        return 1;
+    }
+
+    const auto corpus = load_corpus();
+    BenchmarkRunner runner{options};
+
+    std::printf("%d positions\n", static_cast<int>(corpus.size()));
+    runner.print_header();
+
+    runner.run("Board::put", [&] {
+        std::uint64_t operations = 0;
+
+        for (const auto &position: corpus) {
+            for (const auto &move: position.moves) {
+                auto board = position.game.board();
+                do_not_optimize(board.put(move.piece, move.row, move.column));
+                do_not_optimize(board);
+                operations++;
+            }
+        }
+
+        return operations;
+    });
+
+    runner.run("Board::make+unmake", [&] {
+        std::uint64_t operations = 0;
+
+        for (const auto &position: corpus) {
+            auto board = position.game.board();
+
+            for (const auto &move: position.moves) {
+                auto undo = board.make(move);
+                do_not_optimize(board);
+                board.unmake(undo);
+                operations++;
+            }
+
+            do_not_optimize(board);
+        }
+
+        return operations;
+    });
+
+    runner.run("Board::score", [&] {
+        std::uint64_t operations = 0;
+
+        for (const auto &position: corpus) {
+            do_not_optimize(position.game.board().score(Piece::Black));
+            do_not_optimize(position.game.board().score(Piece::White));
+            operations += 2;
+        }
+
+        return operations;
+    });
+
+    runner.run("Board::legal_moves", [&] {
+        std::uint64_t operations = 0;
+
+        for (const auto &position: corpus) {
+            do_not_optimize(position.game.board().legal_moves(position.game.current_turn()));
+            operations++;
+        }
+
+        return operations;
+    });
+
+    runner.run("calculate_valid_moves", [&] {
+        std::uint64_t operations = 0;
+
+        for (const auto &position: corpus) {
+            do_not_optimize(calculate_valid_moves(position.game.board(), position.game.current_turn()));
+            operations++;
+        }
+
+        return operations;
+    });
+
+    runner.run("Game::next_move", [&] {
+        std::uint64_t operations = 0;
+
+        for (const auto &position: corpus) {
+            for (const auto &move: position.moves) {
+                auto game = position.game;
+                do_not_optimize(game.next_move(move.piece, move.row, move.column));
+                do_not_optimize(game);
+                operations++;
+            }
+        }
+
+        return operations;
+    });
+
+    const auto &evaluator = default_evaluator();
+
+    runner.run("PatternEvaluator::evaluate", [&] {
+        std::uint64_t operations = 0;
+
+        for (const auto &position: corpus) {
+            do_not_optimize(evaluator.evaluate(position.game.board(), position.game.current_turn()));
+            operations++;
+        }
+
+        return operations;
+    });
+
+    std::vector<EvalState> states;
+
+    for (const auto &position: corpus) {
+        states.emplace_back(position.game.board());
+    }
+
+    runner.run("PatternEvaluator::evaluate state", [&] {
+        std::uint64_t operations = 0;
+
+        for (std::size_t i = 0; i < corpus.size(); i++) {
+            do_not_optimize(evaluator.evaluate(states[i], corpus[i].game.current_turn()));
+            operations++;
+        }
+
+        return operations;
+    });
+
+    runner.run("make+EvalState update+unmake", [&] {
+        std::uint64_t operations = 0;
+
+        for (const auto &position: corpus) {
+            auto board = position.game.board();
+            EvalState state{board};
+
+            for (const auto &move: position.moves) {
+                auto undo = board.make(move);
+                state.update(undo);
+                do_not_optimize(state);
+                state.restore(undo);
+                board.unmake(undo);
+                operations++;
+            }
+        }
+
+        return operations;
+    });
+
+    runner.run("Board::canonical", [&] {
+        std::uint64_t operations = 0;
+
+        for (const auto &position: corpus) {
+            do_not_optimize(position.game.board().canonical());
+            operations++;
+        }
+
+        return operations;
+    });
+
+    if (runner.selected("OpeningBook::probe")) {
+        // Every corpus position among a million others, so the search goes as deep as in a large book. The random
+        // suffix keeps concurrent runs from sharing the file.
+        std::mt19937_64 random{1};
+        auto name = "reversi_bench_book_" + std::to_string(std::random_device{}()) + ".bin";
+        const TemporaryFile book_file{std::filesystem::temp_directory_path() / name};
+        auto book_path = book_file.path().string();
+        std::vector<BookEntry> book_entries;
+
+        for (const auto &position: corpus) {
+            book_entries.push_back(BookEntry{.key = book_key(position.game.board(), position.game.current_turn())});
+        }
+
+        for (int i = 0; i < 1 << 20; i++) {
+            book_entries.push_back(BookEntry{.key = random(), .square = 64});
+        }
+
+        if (!write_book(book_path, std::move(book_entries))) {
+            std::cerr << "Can't write " << book_path << std::endl;
+            return 1;
+        }
+
+        const OpeningBook book{book_path};
+
+        runner.run("OpeningBook::probe", [&] {
+            std::uint64_t operations = 0;
+
+            for (const auto &position: corpus) {
+                do_not_optimize(book.probe(position.game.board(), position.game.current_turn()));
+                operations++;
+            }
+
+            return operations;
+        });
+    }
+
+    if (!runner.write_json()) {
+        std::cerr << "Can't write " << options.json_path << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef REVERSI_BENCHMARK_POSITIONS_H
+#define REVERSI_BENCHMARK_POSITIONS_H
+
+#include <string_view>
+
+// Mid-game positions from the standard start, written as move sequences for play_moves. Kept fixed so timings from
+// different builds and machines stay comparable.
+inline constexpr std::string_view benchmark_positions[] = {
+    "f5d6c4g5f6f4g4g3c6c5f3b4c3b6h2d3c2b2a2a1",
+    "f5d6c3f3f4f6c6d3g5b2e6h5g4e7g3h3f7c7c4d7c8b8f2",
+    "f5f4d3d6f3e3d7c5c4c7b7d2c1g4g3h3e2d8c3b6h2h1a7f6g6b4",
+    "e6d6c4f4f5b4c7d7c5b7d3f6g4d2e3c3a3g5g6h7c1a5c8g3a7b5h6e1a4",
+    "d3c5e6d2c4b5d1f5d6e3a6a5f4c3b3d7b6c2b2c6",
+    "c4c5e6e3c6f6f5e7d7d6d3b5a5f4e2b3e8f1g7f7g3g4e1",
+    "f5f4e3d6g4f3c5f6d7h4g7c4b3b4g3h8d3c6e6c3g6h6e7c2a3a2",
+    "f5d6c3f3d3g5g2b2d7c5e6f7e7e3d2g3h3c7g6h5b5f6c4c2d8b3g4h1g8",
+};
+
+#endif //REVERSI_BENCHMARK_POSITIONS_H
@@ -0,0 +1,318 @@
+#include "bitboard.h"
+
+#include <cstdlib>
+#include <string_view>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define REVERSI_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+constexpr std::uint64_t not_column_a = 0xfefefefefefefefe;
+constexpr std::uint64_t not_column_h = 0x7f7f7f7f7f7f7f7f;
+constexpr std::uint64_t all_columns = ~std::uint64_t{0};
+
+// Positive shifts move towards higher bit index, Mask drops bits which wrap around a row edge
+template<int Shift, std::uint64_t Mask>
+inline std::uint64_t shift(std::uint64_t bits) {
+    if constexpr (Shift > 0) {
+        return (bits << Shift) & Mask;
+    } else {
+        return (bits >> -Shift) & Mask;
+    }
+}
+
+// Flood from own discs across up to six enemy discs, landing on the cell past the run
+template<int Shift, std::uint64_t Mask>
+inline std::uint64_t legal_moves_direction(std::uint64_t own, std::uint64_t enemy) {
+    std::uint64_t candidates = shift<Shift, Mask>(own) & enemy;
+    candidates |= shift<Shift, Mask>(candidates) & enemy;
+    candidates |= shift<Shift, Mask>(candidates) & enemy;
+    candidates |= shift<Shift, Mask>(candidates) & enemy;
+    candidates |= shift<Shift, Mask>(candidates) & enemy;
+    candidates |= shift<Shift, Mask>(candidates) & enemy;
+    return shift<Shift, Mask>(candidates);
+}
+
+// Walk a run of up to six enemy discs away from move, keeping it only if an own disc closes the run
+template<int Shift, std::uint64_t Mask>
+inline std::uint64_t flips_direction(std::uint64_t own, std::uint64_t enemy, std::uint64_t move) {
+    std::uint64_t run = shift<Shift, Mask>(move) & enemy;
+    run |= shift<Shift, Mask>(run) & enemy;
+    run |= shift<Shift, Mask>(run) & enemy;
+    run |= shift<Shift, Mask>(run) & enemy;
+    run |= shift<Shift, Mask>(run) & enemy;
+    run |= shift<Shift, Mask>(run) & enemy;
+    std::uint64_t closed = (shift<Shift, Mask>(run) & own) != 0;
+    return run & (0 - closed);
+}
+
+
+std::uint64_t legal_moves_scalar(std::uint64_t own, std::uint64_t enemy) {
+    auto moves = legal_moves_direction<1, not_column_a>(own, enemy) |
+                 legal_moves_direction<-1, not_column_h>(own, enemy) |
+                 legal_moves_direction<8, all_columns>(own, enemy) |
+                 legal_moves_direction<-8, all_columns>(own, enemy) |
+                 legal_moves_direction<9, not_column_a>(own, enemy) |
+                 legal_moves_direction<-9, not_column_h>(own, enemy) |
+                 legal_moves_direction<7, not_column_h>(own, enemy) |
+                 legal_moves_direction<-7, not_column_a>(own, enemy);
+
+    return moves & ~(own | enemy);
+}
+
+std::uint64_t flips_scalar(std::uint64_t own, std::uint64_t enemy, std::uint64_t move) {
+    return flips_direction<1, not_column_a>(own, enemy, move) |
+           flips_direction<-1, not_column_h>(own, enemy, move) |
+           flips_direction<8, all_columns>(own, enemy, move) |
+           flips_direction<-8, all_columns>(own, enemy, move) |
+           flips_direction<9, not_column_a>(own, enemy, move) |
+           flips_direction<-9, not_column_h>(own, enemy, move) |
+           flips_direction<7, not_column_h>(own, enemy, move) |
+           flips_direction<-7, not_column_a>(own, enemy, move);
+}
+
+
+#ifdef REVERSI_X86_SIMD
+
+// AVX2: lanes hold shifts 1, 8, 9 and 7, one register shifting left and one shifting right
+
+__attribute__((target("avx2"))) inline std::uint64_t or_lanes(__m256i bits) {
+    auto half = _mm_or_si128(_mm256_castsi256_si128(bits), _mm256_extracti128_si256(bits, 1));
+    half = _mm_or_si128(half, _mm_unpackhi_epi64(half, half));
+    return static_cast<std::uint64_t>(_mm_cvtsi128_si64(half));
+}
+
+__attribute__((target("avx2"))) std::uint64_t legal_moves_avx2(std::uint64_t own, std::uint64_t enemy) {
+    const auto shifts = _mm256_set_epi64x(7, 9, 8, 1);
+    const auto left_mask = _mm256_set_epi64x(
+        static_cast<long long>(not_column_h), static_cast<long long>(not_column_a),
+        static_cast<long long>(all_columns), static_cast<long long>(not_column_a)
+    );
+    const auto right_mask = _mm256_set_epi64x(
+        static_cast<long long>(not_column_a), static_cast<long long>(not_column_h),
+        static_cast<long long>(all_columns), static_cast<long long>(not_column_h)
+    );
+
+    const auto own_lanes = _mm256_set1_epi64x(static_cast<long long>(own));
+    const auto enemy_lanes = _mm256_set1_epi64x(static_cast<long long>(enemy));
+    const auto enemy_left = _mm256_and_si256(enemy_lanes, left_mask);
+    const auto enemy_right = _mm256_and_si256(enemy_lanes, right_mask);
+
+    auto left = _mm256_and_si256(_mm256_sllv_epi64(own_lanes, shifts), enemy_left);
+    auto right = _mm256_and_si256(_mm256_srlv_epi64(own_lanes, shifts), enemy_right);
+
+    for (int i = 0; i < 5; i++) {
+        left = _mm256_or_si256(left, _mm256_and_si256(_mm256_sllv_epi64(left, shifts), enemy_left));
+        right = _mm256_or_si256(right, _mm256_and_si256(_mm256_srlv_epi64(right, shifts), enemy_right));
+    }
+
+    auto moves = _mm256_or_si256(
+        _mm256_and_si256(_mm256_sllv_epi64(left, shifts), left_mask),
+        _mm256_and_si256(_mm256_srlv_epi64(right, shifts), right_mask)
+    );
+
+    return or_lanes(moves) & ~(own | enemy);
+}
+
+__attribute__((target("avx2"))) std::uint64_t flips_avx2(std::uint64_t own, std::uint64_t enemy, std::uint64_t move) {
+    const auto shifts = _mm256_set_epi64x(7, 9, 8, 1);
+    const auto left_mask = _mm256_set_epi64x(
+        static_cast<long long>(not_column_h), static_cast<long long>(not_column_a),
+        static_cast<long long>(all_columns), static_cast<long long>(not_column_a)
+    );
+    const auto right_mask = _mm256_set_epi64x(
+        static_cast<long long>(not_column_a), static_cast<long long>(not_column_h),
+        static_cast<long long>(all_columns), static_cast<long long>(not_column_h)
+    );
+
+    const auto own_lanes = _mm256_set1_epi64x(static_cast<long long>(own));
+    const auto enemy_lanes = _mm256_set1_epi64x(static_cast<long long>(enemy));
+    const auto move_lanes = _mm256_set1_epi64x(static_cast<long long>(move));
+    const auto enemy_left = _mm256_and_si256(enemy_lanes, left_mask);
+    const auto enemy_right = _mm256_and_si256(enemy_lanes, right_mask);
+
+    auto left = _mm256_and_si256(_mm256_sllv_epi64(move_lanes, shifts), enemy_left);
+    auto right = _mm256_and_si256(_mm256_srlv_epi64(move_lanes, shifts), enemy_right);
+
+    for (int i = 0; i < 5; i++) {
+        left = _mm256_or_si256(left, _mm256_and_si256(_mm256_sllv_epi64(left, shifts), enemy_left));
+        right = _mm256_or_si256(right, _mm256_and_si256(_mm256_srlv_epi64(right, shifts), enemy_right));
+    }
+
+    const auto zero = _mm256_setzero_si256();
+    auto open_left = _mm256_cmpeq_epi64(
+        _mm256_and_si256(_mm256_and_si256(_mm256_sllv_epi64(left, shifts), left_mask), own_lanes), zero
+    );
+    auto open_right = _mm256_cmpeq_epi64(
+        _mm256_and_si256(_mm256_and_si256(_mm256_srlv_epi64(right, shifts), right_mask), own_lanes), zero
+    );
+
+    return or_lanes(_mm256_or_si256(_mm256_andnot_si256(open_left, left), _mm256_andnot_si256(open_right, right)));
+}
+
+
+// SSE4.1: lane 0 holds the board, lane 1 the board mirrored top to bottom, so one left shift covers a direction
+// and its vertical reflection. Horizontal directions shift lane 0 left and lane 1 right and blend the halves.
+
+template<int Shift>
+__attribute__((target("sse4.1"))) inline __m128i shift_vertical(__m128i bits, __m128i mask) {
+    return _mm_and_si128(_mm_slli_epi64(bits, Shift), mask);
+}
+
+__attribute__((target("sse4.1"))) inline __m128i shift_horizontal(__m128i bits, __m128i mask) {
+    return _mm_and_si128(_mm_blend_epi16(_mm_slli_epi64(bits, 1), _mm_srli_epi64(bits, 1), 0xf0), mask);
+}
+
+template<int Shift>
+__attribute__((target("sse4.1"))) inline __m128i legal_moves_vertical(__m128i own, __m128i enemy, __m128i mask) {
+    const auto enemy_mask = _mm_and_si128(enemy, mask);
+    auto candidates = _mm_and_si128(shift_vertical<Shift>(own, mask), enemy_mask);
+
+    for (int i = 0; i < 5; i++) {
+        candidates = _mm_or_si128(candidates, _mm_and_si128(shift_vertical<Shift>(candidates, mask), enemy_mask));
+    }
+
+    return shift_vertical<Shift>(candidates, mask);
+}
+
+template<int Shift>
+__attribute__((target("sse4.1"))) inline __m128i flips_vertical(__m128i own, __m128i enemy, __m128i move, __m128i mask) {
+    const auto enemy_mask = _mm_and_si128(enemy, mask);
+    auto run = _mm_and_si128(shift_vertical<Shift>(move, mask), enemy_mask);
+
+    for (int i = 0; i < 5; i++) {
+        run = _mm_or_si128(run, _mm_and_si128(shift_vertical<Shift>(run, mask), enemy_mask));
+    }
+
+    auto open = _mm_cmpeq_epi64(_mm_and_si128(shift_vertical<Shift>(run, mask), own), _mm_setzero_si128());
+    return _mm_andnot_si128(open, run);
+}
+
+__attribute__((target("sse4.1"))) inline std::uint64_t unmirror_lanes(__m128i bits) {
+    return static_cast<std::uint64_t>(_mm_cvtsi128_si64(bits)) |
+           __builtin_bswap64(static_cast<std::uint64_t>(_mm_extract_epi64(bits, 1)));
+}
+
+__attribute__((target("sse4.1"))) inline std::uint64_t or_lanes(__m128i bits) {
+    return static_cast<std::uint64_t>(_mm_cvtsi128_si64(bits)) | static_cast<std::uint64_t>(_mm_extract_epi64(bits, 1));
+}
+
+__attribute__((target("sse4.1"))) std::uint64_t legal_moves_sse41(std::uint64_t own, std::uint64_t enemy) {
+    const auto own_lanes = _mm_set_epi64x(static_cast<long long>(__builtin_bswap64(own)), static_cast<long long>(own));
+    const auto enemy_lanes = _mm_set_epi64x(
+        static_cast<long long>(__builtin_bswap64(enemy)), static_cast<long long>(enemy)
+    );
+
+    auto vertical = legal_moves_vertical<8>(own_lanes, enemy_lanes, _mm_set1_epi64x(static_cast<long long>(all_columns)));
+    vertical = _mm_or_si128(
+        vertical, legal_moves_vertical<9>(own_lanes, enemy_lanes, _mm_set1_epi64x(static_cast<long long>(not_column_a)))
+    );
+    vertical = _mm_or_si128(
+        vertical, legal_moves_vertical<7>(own_lanes, enemy_lanes, _mm_set1_epi64x(static_cast<long long>(not_column_h)))
+    );
+
+    const auto mask = _mm_set_epi64x(static_cast<long long>(not_column_h), static_cast<long long>(not_column_a));
+    const auto enemy_mask = _mm_and_si128(_mm_set1_epi64x(static_cast<long long>(enemy)), mask);
+    auto candidates = _mm_and_si128(shift_horizontal(_mm_set1_epi64x(static_cast<long long>(own)), mask), enemy_mask);
+
+    for (int i = 0; i < 5; i++) {
+        candidates = _mm_or_si128(candidates, _mm_and_si128(shift_horizontal(candidates, mask), enemy_mask));
+    }
+
+    auto moves = unmirror_lanes(vertical) | or_lanes(shift_horizontal(candidates, mask));
+    return moves & ~(own | enemy);
+}
+
+__attribute__((target("sse4.1"))) std::uint64_t flips_sse41(std::uint64_t own, std::uint64_t enemy, std::uint64_t move) {
+    const auto own_lanes = _mm_set_epi64x(static_cast<long long>(__builtin_bswap64(own)), static_cast<long long>(own));
+    const auto enemy_lanes = _mm_set_epi64x(
+        static_cast<long long>(__builtin_bswap64(enemy)), static_cast<long long>(enemy)
+    );
+    const auto move_lanes = _mm_set_epi64x(
+        static_cast<long long>(__builtin_bswap64(move)), static_cast<long long>(move)
+    );
+
+    auto vertical = flips_vertical<8>(
+        own_lanes, enemy_lanes, move_lanes, _mm_set1_epi64x(static_cast<long long>(all_columns))
+    );
+    vertical = _mm_or_si128(vertical, flips_vertical<9>(
+        own_lanes, enemy_lanes, move_lanes, _mm_set1_epi64x(static_cast<long long>(not_column_a))
+    ));
+    vertical = _mm_or_si128(vertical, flips_vertical<7>(
+        own_lanes, enemy_lanes, move_lanes, _mm_set1_epi64x(static_cast<long long>(not_column_h))
+    ));
+
+    const auto mask = _mm_set_epi64x(static_cast<long long>(not_column_h), static_cast<long long>(not_column_a));
+    const auto enemy_mask = _mm_and_si128(_mm_set1_epi64x(static_cast<long long>(enemy)), mask);
+    auto run = _mm_and_si128(shift_horizontal(_mm_set1_epi64x(static_cast<long long>(move)), mask), enemy_mask);
+
+    for (int i = 0; i < 5; i++) {
+        run = _mm_or_si128(run, _mm_and_si128(shift_horizontal(run, mask), enemy_mask));
+    }
+
+    auto open = _mm_cmpeq_epi64(
+        _mm_and_si128(shift_horizontal(run, mask), _mm_set1_epi64x(static_cast<long long>(own))), _mm_setzero_si128()
+    );
+
+    return unmirror_lanes(vertical) | or_lanes(_mm_andnot_si128(open, run));
+}
+
+#endif
+
+
+constexpr BitboardKernels scalar_kernels{legal_moves_scalar, flips_scalar};
+
+#ifdef REVERSI_X86_SIMD
+constexpr BitboardKernels sse41_kernels{legal_moves_sse41, flips_sse41};
+constexpr BitboardKernels avx2_kernels{legal_moves_avx2, flips_avx2};
+#endif
+
+
+SimdLevel detected_simd_level() {
+    auto level = SimdLevel::Scalar;
+
+#ifdef REVERSI_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        level = SimdLevel::Avx2;
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        level = SimdLevel::Sse41;
+    }
+#endif
+
+    if (auto requested = std::getenv("REVERSI_SIMD")) {
+        auto name = std::string_view{requested};
+
+        if (name == "scalar") {
+            level = SimdLevel::Scalar;
+        } else if (name == "sse4.1" && level == SimdLevel::Avx2) {
+            level = SimdLevel::Sse41;
+        }
+    }
+
+    return level;
+}
+
+const BitboardKernels &bitboard_kernels(SimdLevel level) {
+#ifdef REVERSI_X86_SIMD
+    if (level == SimdLevel::Avx2) {
+        return avx2_kernels;
+    }
+
+    if (level == SimdLevel::Sse41) {
+        return sse41_kernels;
+    }
+#endif
+
+    return scalar_kernels;
+}
+
+const BitboardKernels &active_kernels = bitboard_kernels(detected_simd_level());
+
+std::uint64_t legal_move_mask(std::uint64_t own, std::uint64_t enemy) {
+    return active_kernels.legal_moves(own, enemy);
+}
+
+std::uint64_t flip_mask(std::uint64_t own, std::uint64_t enemy, std::uint64_t move) {
+    return active_kernels.flips(own, enemy, move);
+}
@@ -0,0 +1,58 @@
+#ifndef REVERSI_BITBOARD_H
+#define REVERSI_BITBOARD_H
+
+#include <cstdint>
+
+
+enum class SimdLevel {
+    Scalar,
+    Sse41,
+    Avx2,
+};
+
+
+struct BitboardKernels {
+    // Bit set for every empty cell where own can flip at least one enemy disc
+    std::uint64_t (*legal_moves)(std::uint64_t own, std::uint64_t enemy);
+
+    // Enemy discs flipped when own puts a disc on the single bit set in move, zero if the move flips nothing
+    std::uint64_t (*flips)(std::uint64_t own, std::uint64_t enemy, std::uint64_t move);
+};
+
+
+// Best level supported by this CPU, lowered by REVERSI_SIMD=scalar|sse4.1|avx2 if set
+[[nodiscard]] SimdLevel detected_simd_level();
+
+// Kernels for level, falls back to the highest compiled-in level below it
+[[nodiscard]] const BitboardKernels &bitboard_kernels(SimdLevel level);
+
+[[nodiscard]] std::uint64_t legal_move_mask(std::uint64_t own, std::uint64_t enemy);
+
+[[nodiscard]] std::uint64_t flip_mask(std::uint64_t own, std::uint64_t enemy, std::uint64_t move);
+
+
+// Row r goes to row 7 - r
+[[nodiscard]] inline std::uint64_t flip_vertical(std::uint64_t x) {
+    x = ((x >> 8) & 0x00ff00ff00ff00ff) | ((x & 0x00ff00ff00ff00ff) << 8);
+    x = ((x >> 16) & 0x0000ffff0000ffff) | ((x & 0x0000ffff0000ffff) << 16);
+    return (x >> 32) | (x << 32);
+}
+
+// Column c goes to column 7 - c
+[[nodiscard]] inline std::uint64_t mirror_horizontal(std::uint64_t x) {
+    x = ((x >> 1) & 0x5555555555555555) | ((x & 0x5555555555555555) << 1);
+    x = ((x >> 2) & 0x3333333333333333) | ((x & 0x3333333333333333) << 2);
+    return ((x >> 4) & 0x0f0f0f0f0f0f0f0f) | ((x & 0x0f0f0f0f0f0f0f0f) << 4);
+}
+
+// Cell (r, c) goes to (c, r), swapping the blocks on either side of the diagonal at each scale
+[[nodiscard]] inline std::uint64_t transpose(std::uint64_t x) {
+    auto t = 0x0f0f0f0f00000000 & (x ^ (x << 28));
+    x ^= t ^ (t >> 28);
+    t = 0x3333000033330000 & (x ^ (x << 14));
+    x ^= t ^ (t >> 14);
+    t = 0x5500550055005500 & (x ^ (x << 7));
+    return x ^ t ^ (t >> 7);
+}
+
+#endif //REVERSI_BITBOARD_H
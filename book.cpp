@@ -0,0 +1,82 @@
+#include "book.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+constexpr char book_magic[8] = {'R', 'V', 'B', 'O', 'O', 'K', 0, 2};
+
+constexpr std::size_t book_header_size = 16;
+
+static_assert(sizeof(BookEntry) == 16 && std::endian::native == std::endian::little);
+
+
+std::uint64_t book_key(const Board &board, Piece to_move) {
+    return position_hash(board.canonical().board, to_move);
+}
+
+
+OpeningBook::OpeningBook(const std::string &path) : _file{std::make_unique<MappedFile>(path)} {
+    std::uint64_t count = 0;
+
+    if (_file->size() < book_header_size || std::memcmp(_file->data(), book_magic, sizeof(book_magic)) != 0) {
+        throw std::runtime_error(path + " is not an opening book");
+    }
+
+    std::memcpy(&count, _file->data() + sizeof(book_magic), sizeof(count));
+
+    // Divided rather than multiplied, a corrupt count could wrap around to the size of a short file
+    auto entries_size = _file->size() - book_header_size;
+
+    if (entries_size % sizeof(BookEntry) != 0 || count != entries_size / sizeof(BookEntry)) {
+        throw std::runtime_error(path + " is truncated");
+    }
+
+    _entries = {reinterpret_cast<const BookEntry *>(_file->data() + book_header_size), count};
+}
+
+std::optional<BookMove> OpeningBook::probe(const Board &board, Piece to_move) const {
+    auto canonical = board.canonical();
+    auto key = position_hash(canonical.board, to_move);
+    auto found = std::lower_bound(_entries.begin(), _entries.end(), key, [](const BookEntry &entry, std::uint64_t key) {
+        return entry.key < key;
+    });
+
+    if (found == _entries.end() || found->key != key || found->square >= 64) {
+        return std::nullopt;
+    }
+
+    auto move = Move{.piece = to_move, .row = found->square / 8, .column = found->square % 8};
+
+    return BookMove{
+        .move = transform(move, inverse(canonical.symmetry)),
+        .score = found->score,
+        .depth = found->depth,
+    };
+}
+
+std::span<const BookEntry> OpeningBook::entries() const {
+    return _entries;
+}
+
+
+bool write_book(const std::string &path, std::vector<BookEntry> entries) {
+    std::sort(entries.begin(), entries.end(), [](const BookEntry &a, const BookEntry &b) {
+        return a.key < b.key || (a.key == b.key && a.depth > b.depth);
+    });
+
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const BookEntry &a, const BookEntry &b) {
+        return a.key == b.key;
+    }), entries.end());
+
+    std::uint64_t count = entries.size();
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+
+    file.write(book_magic, sizeof(book_magic));
+    file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char *>(entries.data()), static_cast<std::streamsize>(count * sizeof(BookEntry)));
+
+    return file.good();
+}
@@ -0,0 +1,63 @@
+#ifndef REVERSI_BOOK_H
+#define REVERSI_BOOK_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "reversi.h"
+
+// Opening book: one entry per position up to symmetry, sorted by key in a file that is memory-mapped and searched in
+// place. A file is an 8-byte magic and an 8-byte entry count followed by the entries, little-endian.
+
+
+// Stored for the canonical board of the position, see Board::canonical
+struct BookEntry {
+    std::uint64_t key{0};
+    // From the side to move, in the units of the search that produced it
+    std::int16_t score{0};
+    // Best move on the canonical board, row * 8 + column
+    std::uint8_t square{0};
+    std::uint8_t depth{0};
+    // Games of the source corpus that reached the position
+    std::uint32_t games{0};
+};
+
+
+struct BookMove {
+    Move move{};
+    int score{0};
+    int depth{0};
+};
+
+
+// Same key for all 8 symmetric versions of a position with the same side to move, the position hash of the
+// canonical board
+[[nodiscard]] std::uint64_t book_key(const Board &board, Piece to_move);
+
+
+class OpeningBook {
+public:
+    // Throws std::runtime_error if the file can't be mapped or is not a book
+    explicit OpeningBook(const std::string &path);
+
+    // Binary search over the mapped entries, nothing if the position is not in the book
+    [[nodiscard]] std::optional<BookMove> probe(const Board &board, Piece to_move) const;
+
+    [[nodiscard]] std::span<const BookEntry> entries() const;
+
+private:
+    std::unique_ptr<MappedFile> _file;
+    std::span<const BookEntry> _entries{};
+};
+
+
+// Sorts entries by key and writes them, false if the file can't be written. Entries with the same key keep the
+// deepest.
+bool write_book(const std::string &path, std::vector<BookEntry> entries);
+
+#endif //REVERSI_BOOK_H
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "book.h"
+#include "game_record.h"
+#include "search.h"
+
+// Builds an opening book from game records: every position within the first plies of the games that was reached
+// often enough is searched and stored with its best move. Positions are folded over the board symmetries before
+// counting, so transposed openings add up. An existing book can be given to deepen it, its entries are kept unless
+// they were searched shallower than asked and searched again.
+
+struct Options {
+    std::vector<std::string> games{};
+    // Book to extend, nothing to start from if empty
+    std::string input{};
+    std::string output{};
+    int plies{20};
+    // Positions seen in fewer games are left out
+    std::uint32_t min_games{2};
+    int depth{10};
+    int threads{static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u))};
+    std::size_t hash_mb{16};
+};
+
+struct Candidate {
+    // Canonical board, so the searched move can be stored as it is
+    Board board{};
+    Piece to_move{Piece::Black};
+    std::uint32_t games{0};
+    // Entry of the input book, searched again only if shallower than asked
+    bool known{false};
+    BookEntry entry{};
+};
+
+using Candidates = std::unordered_map<std::uint64_t, Candidate>;
+
+// Returns false if a file can't be read
+bool count_positions(const Options &options, Candidates &candidates) {
+    for (const auto &path: options.games) {
+        std::unique_ptr<GameRecordReader> reader;
+
+        try {
+            reader = std::make_unique<GameRecordReader>(path);
+        } catch (const std::runtime_error &error) {
+            std::cerr << error.what() << std::endl;
+            return false;
+        }
+
+        for (const auto &record: *reader) {
+            Game game;
+            auto plies = std::min<std::size_t>(record.moves.size(), options.plies);
+
+            // Discs only ever get added, so a game never counts a position twice
+            for (std::size_t ply = 0; ply < plies; ply++) {
+                auto to_move = game.current_turn();
+                auto key = book_key(game.board(), to_move);
+                auto &candidate = candidates[key];
+
+                if (candidate.games++ == 0) {
+                    candidate.board = game.board().canonical().board;
+                    candidate.to_move = to_move;
+                }
+
+                if (!play_record(game, record.moves.subspan(ply, 1))) {
+                    break;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+void search_positions(const Options &options, std::vector<Candidate *> &pending) {
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::size_t> done{0};
+    std::vector<std::thread> workers;
+
+    for (int thread = 0; thread < std::max(options.threads, 1); thread++) {
+        workers.emplace_back([&] {
+            // One player per side as the side is fixed at construction, each with its own table
+            auto search_options = SearchOptions{.hash_mb = options.hash_mb};
+            SearchPlayer black{Piece::Black, SearchLimits{.depth = options.depth}, search_options};
+            SearchPlayer white{Piece::White, SearchLimits{.depth = options.depth}, search_options};
+
+            for (auto i = next++; i < pending.size(); i = next++) {
+                auto &candidate = *pending[i];
+                auto &player = candidate.to_move == Piece::Black ? black : white;
+                auto result = player.search(Game{candidate.board});
+
+                candidate.entry.score = static_cast<std::int16_t>(result.score);
+                candidate.entry.square = static_cast<std::uint8_t>(result.move.row * 8 + result.move.column);
+                candidate.entry.depth = static_cast<std::uint8_t>(std::min(result.depth, 255));
+
+                if (++done % 1000 == 0) {
+                    std::printf("%zu / %zu positions searched\n", done.load(), pending.size());
+                    std::fflush(stdout);
+                }
+            }
+        });
+    }
+
+    for (auto &worker: workers) {
+        worker.join();
+    }
+}
+
+bool parse_options(int argc, char *argv[], Options &options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        auto option = std::string{argv[i]};
+
+        try {
+            if (option == "--games") {
+                options.games.emplace_back(argv[i + 1]);
+            } else if (option == "--input") {
+                options.input = argv[i + 1];
+            } else if (option == "--output") {
+                options.output = argv[i + 1];
+            } else if (option == "--plies") {
+                options.plies = std::stoi(argv[i + 1]);
+            } else if (option == "--min-games") {
+                options.min_games = std::max<std::uint32_t>(std::stoul(argv[i + 1]), 1);
+            } else if (option == "--depth") {
+                options.depth = std::clamp(std::stoi(argv[i + 1]), 1, 60);
+            } else if (option == "--threads") {
+                options.threads = std::stoi(argv[i + 1]);
+            } else if (option == "--hash-mb") {
+                options.hash_mb = std::stoul(argv[i + 1]);
+            } else {
+                return false;
+            }
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    return argc % 2 == 1 && !(options.games.empty() && options.input.empty()) && !options.output.empty();
+}
+
+int main(int argc, char *argv[]) {
+    auto options = Options{};
+
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " (--games <path>)... [--input <book>] --output <path> [--plies <plies>]"
+                  << " [--min-games <games>] [--depth <depth>] [--threads <threads>] [--hash-mb <megabytes>]"
+                  << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Candidates candidates;
+
+    if (!count_positions(options, candidates)) {
+        return 1;
+    }
+
+    std::vector<BookEntry> entries;
+
+    if (!options.input.empty()) {
+        try {
+            OpeningBook input{options.input};
+            entries.assign(input.entries().begin(), input.entries().end());
+        } catch (const std::runtime_error &error) {
+            std::cerr << error.what() << std::endl;
+            return 1;
+        }
+    }
+
+    for (auto &entry: entries) {
+        if (auto found = candidates.find(entry.key); found != candidates.end()) {
+            found->second.known = true;
+            found->second.entry = entry;
+        }
+    }
+
+    std::vector<Candidate *> pending;
+
+    for (auto &[key, candidate]: candidates) {
+        if (candidate.games < options.min_games) {
+            continue;
+        }
+
+        if (!candidate.known || candidate.entry.depth < options.depth) {
+            pending.push_back(&candidate);
+        }
+
+        candidate.entry.key = key;
+        candidate.entry.games = std::max(candidate.entry.games, candidate.games);
+    }
+
+    std::printf("%zu positions, %zu to search at depth %d\n", candidates.size(), pending.size(), options.depth);
+    std::fflush(stdout);
+
+    search_positions(options, pending);
+
+    // Input entries of counted positions are carried by their candidate
+    std::erase_if(entries, [&](const BookEntry &entry) {
+        auto found = candidates.find(entry.key);
+        return found != candidates.end() && found->second.games >= options.min_games;
+    });
+
+    for (const auto &[key, candidate]: candidates) {
+        if (candidate.games >= options.min_games) {
+            entries.push_back(candidate.entry);
+        }
+    }
+
+    if (!write_book(options.output, std::move(entries))) {
+        std::cerr << "Can't write " << options.output << std::endl;
+        return 1;
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%s written in %.2f s\n", options.output.c_str(), seconds);
+    return 0;
+}
@@ -0,0 +1,375 @@
+#include "endgame.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "bitboard.h"
+#include "transposition.h"
+
+// Works on raw own/enemy bitboards instead of Board, the last plies of a solve are too short to pay for hashing
+
+constexpr std::uint64_t quadrant_masks[4] = {
+    0x000000000f0f0f0f,
+    0x00000000f0f0f0f0,
+    0x0f0f0f0f00000000,
+    0xf0f0f0f000000000,
+};
+
+constexpr std::uint64_t corners = 0x8100000000000081;
+
+// Below this many empties moves are ordered by parity alone, above it by enemy mobility first
+constexpr int fastest_first_empties = 7;
+
+// Positions with at least this many empties go through the transposition table
+constexpr int table_empties = 10;
+
+// Quadrants with an odd number of empty cells. Moving into them first tends to leave the last move of each region
+// to the side moving, which is where most cutoffs come from.
+std::uint64_t odd_quadrants(std::uint64_t empties) {
+    std::uint64_t odd = 0;
+
+    for (auto quadrant: quadrant_masks) {
+        if (std::popcount(empties & quadrant) % 2 == 1) {
+            odd |= quadrant;
+        }
+    }
+
+    return odd;
+}
+
+int final_difference(std::uint64_t own, std::uint64_t enemy) {
+    return std::popcount(own) - std::popcount(enemy);
+}
+
+// Side to move is always own here, so the pair alone identifies the position. Cheaper than a Zobrist walk.
+std::uint64_t position_key(std::uint64_t own, std::uint64_t enemy) {
+    auto key = own * 0x9e3779b97f4a7c15 ^ std::rotl(enemy * 0xc2b2ae3d27d4eb4f, 31);
+    key ^= key >> 29;
+    key *= 0xbf58476d1ce4e5b9;
+    return key ^ (key >> 32);
+}
+
+
+class EndgameSolver {
+public:
+    explicit EndgameSolver(TranspositionTable &table) : _table{table} {}
+
+    int solve(std::uint64_t own, std::uint64_t enemy, int alpha, int beta, bool passed) {
+        auto empties = ~(own | enemy);
+        auto empty_count = std::popcount(empties);
+
+        if (empty_count <= 4) {
+            return solve_few(own, enemy, alpha, beta, empties, empty_count);
+        }
+
+        _nodes++;
+
+        auto moves = legal_move_mask(own, enemy);
+
+        if (moves == 0) {
+            if (passed) {
+                return final_difference(own, enemy);
+            }
+
+            return -solve(enemy, own, -beta, -alpha, true);
+        }
+
+        auto key = position_key(own, enemy);
+        auto table_square = -1;
+
+        if (empty_count >= table_empties) {
+            TranspositionEntry entry;
+
+            if (_table.probe(key, entry)) {
+                table_square = entry.best_square;
+
+                if (entry.bound == Bound::Exact) {
+                    return entry.score;
+                }
+
+                if (entry.bound == Bound::Lower && entry.score >= beta) {
+                    return entry.score;
+                }
+
+                if (entry.bound == Bound::Upper && entry.score <= alpha) {
+                    return entry.score;
+                }
+            }
+        }
+
+        int squares[64];
+        auto count = order_moves(own, enemy, moves, empties, empty_count, squares);
+
+        if (auto found = std::find(squares, squares + count, table_square); found != squares + count) {
+            std::rotate(squares, found, found + 1);
+        }
+
+        auto original_alpha = alpha;
+        auto best = -65;
+        auto best_square = squares[0];
+
+        for (int i = 0; i < count; i++) {
+            auto move = std::uint64_t{1} << squares[i];
+            auto flipped = flip_mask(own, enemy, move);
+            auto next_own = enemy & ~flipped;
+            auto next_enemy = own | flipped | move;
+            int score;
+
+            // Principal variation search: later moves only need to be shown worse than the best so far
+            if (i == 0 || beta - alpha == 1) {
+                score = -solve(next_own, next_enemy, -beta, -alpha, false);
+            } else {
+                score = -solve(next_own, next_enemy, -alpha - 1, -alpha, false);
+
+                if (score > alpha && score < beta) {
+                    score = -solve(next_own, next_enemy, -beta, -score, false);
+                }
+            }
+
+            if (score > best) {
+                best = score;
+                best_square = squares[i];
+
+                if (score > alpha) {
+                    alpha = score;
+
+                    if (alpha >= beta) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (empty_count >= table_empties) {
+            auto bound = best <= original_alpha ? Bound::Upper : best >= beta ? Bound::Lower : Bound::Exact;
+            _table.store(key, TranspositionEntry{
+                .score = best, .depth = empty_count, .bound = bound, .best_square = best_square
+            });
+        }
+
+        return best;
+    }
+
+    int order_moves(
+        std::uint64_t own,
+        std::uint64_t enemy,
+        std::uint64_t moves,
+        std::uint64_t empties,
+        int empty_count,
+        int (&squares)[64]
+    ) const {
+        int keys[64];
+        int count = 0;
+        auto odd = odd_quadrants(empties);
+
+        for (; moves != 0; moves &= moves - 1) {
+            auto move = moves & (0 - moves);
+            auto key = (move & odd) != 0 ? 0 : 1;
+
+            if (empty_count > fastest_first_empties) {
+                // Fewest enemy replies first, corners count as one reply less
+                auto flipped = flip_mask(own, enemy, move);
+                auto replies = std::popcount(legal_move_mask(enemy & ~flipped, own | flipped | move));
+                key += 4 * replies - ((move & corners) != 0 ? 4 : 0);
+            }
+
+            squares[count] = std::countr_zero(move);
+            keys[count] = key;
+            count++;
+        }
+
+        // Insertion sort, move lists are short
+        for (int i = 1; i < count; i++) {
+            auto square = squares[i];
+            auto key = keys[i];
+            auto j = i;
+
+            for (; j > 0 && keys[j - 1] > key; j--) {
+                squares[j] = squares[j - 1];
+                keys[j] = keys[j - 1];
+            }
+
+            squares[j] = square;
+            keys[j] = key;
+        }
+
+        return count;
+    }
+
+    [[nodiscard]] std::uint64_t nodes() const {
+        return _nodes;
+    }
+
+private:
+    // Up to four empties: no move generation, each empty square is tried directly, odd quadrants first
+    int solve_few(std::uint64_t own, std::uint64_t enemy, int alpha, int beta, std::uint64_t empties, int empty_count) {
+        int squares[4];
+        int count = 0;
+        auto odd = odd_quadrants(empties);
+
+        for (auto bits = empties & odd; bits != 0; bits &= bits - 1) {
+            squares[count++] = std::countr_zero(bits);
+        }
+
+        for (auto bits = empties & ~odd; bits != 0; bits &= bits - 1) {
+            squares[count++] = std::countr_zero(bits);
+        }
+
+        switch (empty_count) {
+            case 4:
+                return solve_last<4>(own, enemy, alpha, beta, squares, false);
+            case 3:
+                return solve_last<3>(own, enemy, alpha, beta, squares, false);
+            case 2:
+                return solve_last<2>(own, enemy, alpha, beta, squares, false);
+            case 1:
+                return solve_last_one(own, enemy, squares[0]);
+            default:
+                _nodes++;
+                return final_difference(own, enemy);
+        }
+    }
+
+    template<int Empties>
+    int solve_last(std::uint64_t own, std::uint64_t enemy, int alpha, int beta, const int *squares, bool passed) {
+        _nodes++;
+
+        auto best = -65;
+
+        for (int i = 0; i < Empties; i++) {
+            auto move = std::uint64_t{1} << squares[i];
+            auto flipped = flip_mask(own, enemy, move);
+
+            if (flipped == 0) {
+                continue;
+            }
+
+            // Remaining empties keep their order with the played square taken out
+            int rest[Empties - 1];
+
+            for (int j = 0, k = 0; j < Empties; j++) {
+                if (j != i) {
+                    rest[k++] = squares[j];
+                }
+            }
+
+            int score;
+
+            if constexpr (Empties == 2) {
+                score = -solve_last_one(enemy & ~flipped, own | flipped | move, rest[0]);
+            } else {
+                score = -solve_last<Empties - 1>(enemy & ~flipped, own | flipped | move, -beta, -alpha, rest, false);
+            }
+
+            if (score > best) {
+                best = score;
+
+                if (score > alpha) {
+                    alpha = score;
+
+                    if (alpha >= beta) {
+                        return best;
+                    }
+                }
+            }
+        }
+
+        if (best != -65) {
+            return best;
+        }
+
+        if (passed) {
+            return final_difference(own, enemy);
+        }
+
+        return -solve_last<Empties>(enemy, own, -beta, -alpha, squares, true);
+    }
+
+    // One empty square left: whoever can play there does, no search needed
+    int solve_last_one(std::uint64_t own, std::uint64_t enemy, int square) {
+        _nodes++;
+
+        auto move = std::uint64_t{1} << square;
+
+        if (auto flipped = flip_mask(own, enemy, move); flipped != 0) {
+            return 2 * (std::popcount(own | flipped) + 1) - 64;
+        }
+
+        if (auto flipped = flip_mask(enemy, own, move); flipped != 0) {
+            return 64 - 2 * (std::popcount(enemy | flipped) + 1);
+        }
+
+        return final_difference(own, enemy);
+    }
+
+    std::uint64_t _nodes{0};
+    TranspositionTable &_table;
+};
+
+
+EndgameResult solve_endgame(const Board &board, Piece piece, SolveMode mode) {
+    // The table only pays off from table_empties on, and the tree grows several times with each empty beyond that
+    auto empties = 64 - std::popcount(board.discs(Piece::Black) | board.discs(Piece::White));
+    auto megabytes = empties < table_empties
+                     ? 0
+                     : std::min(endgame_table_megabytes, std::size_t{1} << std::max(empties - 16, 0));
+    TranspositionTable table{megabytes};
+    return solve_endgame(board, piece, table, mode);
+}
+
+EndgameResult solve_endgame(const Board &board, Piece piece, TranspositionTable &table, SolveMode mode) {
+    auto own = board.discs(piece);
+    auto enemy = board.discs(opponent(piece));
+    auto result = EndgameResult{};
+    auto moves = legal_move_mask(own, enemy);
+
+    if (moves == 0) {
+        return result;
+    }
+
+    table.new_search();
+    EndgameSolver solver{table};
+    auto empties = ~(own | enemy);
+    int squares[64];
+    auto count = solver.order_moves(own, enemy, moves, empties, std::popcount(empties), squares);
+
+    // Win/loss/draw needs only to tell scores apart from zero, a null window around it does that
+    auto alpha = mode == SolveMode::Exact ? -65 : -1;
+    auto beta = mode == SolveMode::Exact ? 65 : 1;
+    auto best = -65;
+
+    for (int i = 0; i < count; i++) {
+        auto move = std::uint64_t{1} << squares[i];
+        auto flipped = flip_mask(own, enemy, move);
+        auto next_own = enemy & ~flipped;
+        auto next_enemy = own | flipped | move;
+        int score;
+
+        if (i == 0) {
+            score = -solver.solve(next_own, next_enemy, -beta, -alpha, false);
+        } else {
+            score = -solver.solve(next_own, next_enemy, -alpha - 1, -alpha, false);
+
+            if (score > alpha && score < beta) {
+                score = -solver.solve(next_own, next_enemy, -beta, -score, false);
+            }
+        }
+
+        if (score > best) {
+            best = score;
+            result.move = Move{.piece = piece, .row = squares[i] / 8, .column = squares[i] % 8};
+
+            if (score > alpha) {
+                alpha = score;
+
+                if (alpha >= beta) {
+                    break;
+                }
+            }
+        }
+    }
+
+    result.score = mode == SolveMode::Exact ? best : (best > 0) - (best < 0);
+    result.nodes = solver.nodes() + 1;
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef REVERSI_ENDGAME_H
+#define REVERSI_ENDGAME_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "reversi.h"
+#include "transposition.h"
+
+
+enum class SolveMode {
+    // Final disc difference
+    Exact,
+    // Only whether the game is won, drawn or lost, which needs far fewer nodes
+    WinLossDraw,
+};
+
+
+struct EndgameResult {
+    // Invalid (row and column -1) if piece has no legal move
+    Move move{};
+    // Own minus enemy discs at the end of the game with best play from both sides. In WinLossDraw mode only the sign
+    // is meaningful, as 1, 0 or -1
+    int score{0};
+    std::uint64_t nodes{0};
+};
+
+
+// Enough for solves of up to about 24 empty cells
+constexpr std::size_t endgame_table_megabytes = 8;
+
+
+// Searches the position to the end of the game. Meant for positions with at most 20 to 24 empty cells, larger
+// positions are solved too but may take very long. Allocates a table sized for the position on each call.
+[[nodiscard]] EndgameResult solve_endgame(const Board &board, Piece piece, SolveMode mode = SolveMode::Exact);
+
+// Same, with a table owned by the caller and kept across solves. Entries hold exact game results, so they stay valid
+// for any later position and either mode.
+[[nodiscard]] EndgameResult solve_endgame(
+    const Board &board, Piece piece, TranspositionTable &table, SolveMode mode = SolveMode::Exact
+);
+
+#endif //REVERSI_ENDGAME_H
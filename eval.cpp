@@ -0,0 +1,457 @@
+#include "eval.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// Every pattern is read from the top-left corner of the board. The other placements come from reading the same cells
+// of the board rotated by 90 degrees and flipped top to bottom, so the eight symmetric copies of a pattern share one
+// weight table.
+
+constexpr Pattern feature_patterns[feature_count] = {
+    Pattern::Edge2X, Pattern::Corner3x3, Pattern::Corner2x5, Pattern::Corner2x5,
+    Pattern::Diagonal4, Pattern::Diagonal5, Pattern::Diagonal6, Pattern::Diagonal7,
+    Pattern::Edge2X, Pattern::Corner3x3, Pattern::Corner2x5, Pattern::Corner2x5,
+    Pattern::Diagonal4, Pattern::Diagonal5, Pattern::Diagonal6, Pattern::Diagonal7,
+    Pattern::Edge2X, Pattern::Corner3x3, Pattern::Corner2x5, Pattern::Corner2x5,
+    Pattern::Diagonal4, Pattern::Diagonal5, Pattern::Diagonal6, Pattern::Diagonal7,
+    Pattern::Edge2X, Pattern::Corner3x3, Pattern::Corner2x5, Pattern::Corner2x5,
+    Pattern::Diagonal4, Pattern::Diagonal5, Pattern::Diagonal6, Pattern::Diagonal7,
+    Pattern::Diagonal8, Pattern::Diagonal8,
+};
+
+constexpr int pattern_sizes[pattern_count] = {10, 9, 10, 4, 5, 6, 7, 8};
+
+constexpr int power_of_three(int exponent) {
+    int power = 1;
+
+    for (int i = 0; i < exponent; i++) {
+        power *= 3;
+    }
+
+    return power;
+}
+
+constexpr auto pattern_offsets = [] {
+    std::array<int, pattern_count + 1> offsets{};
+
+    for (int i = 0; i < pattern_count; i++) {
+        offsets[i + 1] = offsets[i] + power_of_three(pattern_sizes[i]);
+    }
+
+    return offsets;
+}();
+
+// Configurations of all patterns in one phase
+constexpr int phase_weights = pattern_offsets[pattern_count];
+
+constexpr auto feature_offsets = [] {
+    std::array<int, feature_count> offsets{};
+
+    for (int i = 0; i < feature_count; i++) {
+        offsets[i] = pattern_offsets[static_cast<int>(feature_patterns[i])];
+    }
+
+    return offsets;
+}();
+
+// Takes the board to the one each group of eight features reads from the top-left corner, turned 90 degrees more for
+// every group
+constexpr Symmetry group_symmetries[4] = {
+    Symmetry::Identity, Symmetry::RotateLeft, Symmetry::Rotate180, Symmetry::RotateRight,
+};
+
+// The same followed by flipping the rows
+constexpr Symmetry flipped_group_symmetries[4] = {
+    Symmetry::FlipVertical, Symmetry::Transpose, Symmetry::MirrorHorizontal, Symmetry::AntiTranspose,
+};
+
+std::array<int, max_pattern_size> corner_squares(Pattern pattern) {
+    switch (pattern) {
+        case Pattern::Edge2X:
+            return {0, 1, 2, 3, 4, 5, 6, 7, 9, 14};
+        case Pattern::Corner3x3:
+            return {0, 1, 2, 8, 9, 10, 16, 17, 18};
+        case Pattern::Corner2x5:
+            return {0, 1, 2, 3, 4, 8, 9, 10, 11, 12};
+        default:
+            break;
+    }
+
+    std::array<int, max_pattern_size> squares{};
+    auto size = pattern_sizes[static_cast<int>(pattern)];
+
+    for (int i = 0; i < size; i++) {
+        squares[i] = i * 9 + 8 - size;
+    }
+
+    return squares;
+}
+
+std::array<Feature, feature_count> make_features() {
+    std::array<Feature, feature_count> result{};
+
+    for (int i = 0; i < feature_count; i++) {
+        auto pattern = feature_patterns[i];
+        // Groups of eight follow the four rotations with the second 2x5 block read from the flipped board, the
+        // two main diagonals come last
+        auto symmetry = i >= 32 ? group_symmetries[i - 32] :
+                        i % 8 == 3 ? flipped_group_symmetries[i / 8] : group_symmetries[i / 8];
+        auto canonical = corner_squares(pattern);
+
+        result[i].pattern = pattern;
+        result[i].size = pattern_sizes[static_cast<int>(pattern)];
+
+        for (int digit = 0; digit < result[i].size; digit++) {
+            auto corner_cell = Move{.row = canonical[digit] / 8, .column = canonical[digit] % 8};
+            auto cell = transform(corner_cell, inverse(symmetry));
+            result[i].squares[digit] = cell.row * 8 + cell.column;
+        }
+    }
+
+    return result;
+}
+
+
+const std::array<Feature, feature_count> &features() {
+    static const auto all = make_features();
+    return all;
+}
+
+int pattern_size(Pattern pattern) {
+    return pattern_sizes[static_cast<int>(pattern)];
+}
+
+int disc_phase(int discs) {
+    return std::clamp((discs - 4) / 5, 0, phase_count - 1);
+}
+
+int phase(const Board &board) {
+    return phase(board.discs(Piece::Black), board.discs(Piece::White));
+}
+
+int phase(std::uint64_t black, std::uint64_t white) {
+    return disc_phase(std::popcount(black | white));
+}
+
+FeatureIndices feature_indices(const Board &board) {
+    return feature_indices(board.discs(Piece::Black), board.discs(Piece::White));
+}
+
+std::size_t weight_count() {
+    return static_cast<std::size_t>(phase_count) * phase_weights;
+}
+
+std::size_t weight_offset(int phase, int feature) {
+    return static_cast<std::size_t>(phase) * phase_weights + feature_offsets[feature];
+}
+
+
+// Most features any one cell belongs to
+constexpr int max_square_features = 6;
+
+struct SquareFeatures {
+    int count{0};
+    std::uint8_t features[max_square_features]{};
+    std::uint32_t powers[max_square_features]{};
+};
+
+std::array<SquareFeatures, 64> make_square_features() {
+    std::array<SquareFeatures, 64> result{};
+
+    for (int i = 0; i < feature_count; i++) {
+        const auto &feature = features()[i];
+
+        for (int digit = 0, power = 1; digit < feature.size; digit++, power *= 3) {
+            auto &square = result[feature.squares[digit]];
+            square.features[square.count] = static_cast<std::uint8_t>(i);
+            square.powers[square.count] = static_cast<std::uint32_t>(power);
+            square.count++;
+        }
+    }
+
+    return result;
+}
+
+const std::array<SquareFeatures, 64> square_features = make_square_features();
+
+// Feature indices are summed eight 16-bit lanes at a time
+using IndexLanes = std::uint16_t __attribute__((vector_size(16)));
+
+constexpr int lane_vectors = (feature_count + 7) / 8;
+
+// Indices of every feature with only the black discs of one row, white discs count twice as much. The indices of a
+// board are the sums over its rows.
+struct RowIndices {
+    IndexLanes lanes[lane_vectors]{};
+};
+
+// Row * 256 + the row's byte of the bitboard
+std::vector<RowIndices> make_row_indices() {
+    std::vector<RowIndices> result(8 * 256);
+
+    for (int row = 0; row < 8; row++) {
+        for (int bits = 0; bits < 256; bits++) {
+            auto &entry = result[row * 256 + bits];
+
+            for (int column = 0; column < 8; column++) {
+                if (((bits >> column) & 1) == 0) {
+                    continue;
+                }
+
+                const auto &square = square_features[row * 8 + column];
+
+                for (int i = 0; i < square.count; i++) {
+                    auto feature = square.features[i];
+                    entry.lanes[feature / 8][feature % 8] += static_cast<std::uint16_t>(square.powers[i]);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+const std::vector<RowIndices> row_indices = make_row_indices();
+
+// Adds the same multiple of each cell's digit power to the features of all cells in mask
+void add_digits(FeatureIndices &indices, std::uint64_t mask, int multiple) {
+    for (; mask != 0; mask &= mask - 1) {
+        const auto &square = square_features[std::countr_zero(mask)];
+
+        for (int i = 0; i < square.count; i++) {
+            indices[square.features[i]] += square.powers[i] * static_cast<std::uint32_t>(multiple);
+        }
+    }
+}
+
+
+FeatureIndices feature_indices(std::uint64_t black, std::uint64_t white) {
+    // Largest index is 3^10 - 1, so no lane overflows
+    IndexLanes black_sums[lane_vectors]{};
+    IndexLanes white_sums[lane_vectors]{};
+
+    for (int row = 0; row < 8; row++) {
+        const auto &black_row = row_indices[row * 256 + ((black >> (row * 8)) & 0xff)];
+        const auto &white_row = row_indices[row * 256 + ((white >> (row * 8)) & 0xff)];
+
+        for (int i = 0; i < lane_vectors; i++) {
+            black_sums[i] += black_row.lanes[i];
+            white_sums[i] += white_row.lanes[i];
+        }
+    }
+
+    FeatureIndices indices;
+
+    for (int i = 0; i < feature_count; i++) {
+        indices[i] = black_sums[i / 8][i % 8] + 2 * white_sums[i / 8][i % 8];
+    }
+
+    return indices;
+}
+
+
+EvalState::EvalState(const Board &board)
+    : _indices{feature_indices(board)},
+      _discs{std::popcount(board.discs(Piece::Black) | board.discs(Piece::White))} {
+}
+
+// Digits are 1 for black and 2 for white, so a flip to white adds each digit's power once and a flip to black takes
+// it away. Unsigned wrap-around cancels out as the final indices are never negative.
+void EvalState::update(const UndoInfo &undo) {
+    if (undo.flipped == 0) {
+        return;
+    }
+
+    auto placed = std::uint64_t{1} << (undo.move.row * 8 + undo.move.column);
+    auto white = undo.move.piece == Piece::White;
+
+    add_digits(_indices, placed, white ? 2 : 1);
+    add_digits(_indices, undo.flipped, white ? 1 : -1);
+    _discs++;
+}
+
+void EvalState::restore(const UndoInfo &undo) {
+    if (undo.flipped == 0) {
+        return;
+    }
+
+    auto placed = std::uint64_t{1} << (undo.move.row * 8 + undo.move.column);
+    auto white = undo.move.piece == Piece::White;
+
+    add_digits(_indices, placed, white ? -2 : -1);
+    add_digits(_indices, undo.flipped, white ? -1 : 1);
+    _discs--;
+}
+
+const FeatureIndices &EvalState::indices() const {
+    return _indices;
+}
+
+int EvalState::phase() const {
+    return disc_phase(_discs);
+}
+
+
+// In 1/eval_scale discs, for a disc of the side it belongs to. Rows listed top to bottom.
+constexpr int square_values[64] = {
+    40, -8, 8, 4, 4, 8, -8, 40,
+    -8, -20, -2, -2, -2, -2, -20, -8,
+    8, -2, 2, 1, 1, 2, -2, 8,
+    4, -2, 1, 0, 0, 1, -2, 4,
+    4, -2, 1, 0, 0, 1, -2, 4,
+    8, -2, 2, 1, 1, 2, -2, 8,
+    -8, -20, -2, -2, -2, -2, -20, -8,
+    40, -8, 8, 4, 4, 8, -8, 40,
+};
+
+// Value of the cells next to a corner once that corner is taken
+constexpr int settled_value = 2;
+
+int adjacent_corner(int square) {
+    auto row = square / 8;
+    auto column = square % 8;
+
+    auto corner = (row == 0 || row == 7) && (column == 0 || column == 7);
+
+    if ((row > 1 && row < 6) || (column > 1 && column < 6) || corner) {
+        return -1;
+    }
+
+    return (row < 2 ? 0 : 56) + (column < 2 ? 0 : 7);
+}
+
+// Weight file header, followed by the weights as 16-bit little-endian integers
+struct WeightHeader {
+    char magic[8]{'R', 'V', 'W', 'G', 'H', 'T', 0, 1};
+    std::uint32_t scale{eval_scale};
+    std::uint32_t phases{phase_count};
+    std::uint32_t features{feature_count};
+    std::uint32_t weights{0};
+};
+
+static_assert(sizeof(WeightHeader) == 24 && std::endian::native == std::endian::little);
+
+PatternEvaluator::PatternEvaluator() : _storage(weight_count()) {
+    // Each cell's value is split evenly between the features covering it, so the features add up to the square table
+    int coverage[64] = {};
+
+    for (const auto &feature: features()) {
+        for (int digit = 0; digit < feature.size; digit++) {
+            coverage[feature.squares[digit]]++;
+        }
+    }
+
+    for (int pattern = 0; pattern < pattern_count; pattern++) {
+        auto squares = corner_squares(static_cast<Pattern>(pattern));
+        auto size = pattern_sizes[pattern];
+
+        for (int index = 0; index < power_of_three(size); index++) {
+            int digits[max_pattern_size];
+
+            for (int digit = 0, rest = index; digit < size; digit++, rest /= 3) {
+                digits[digit] = rest % 3;
+            }
+
+            for (int phase = 0; phase < phase_count; phase++) {
+                // Positional play early, plain disc count by the last moves
+                auto weight_of_discs = static_cast<double>(phase) / (phase_count - 1);
+                double value = 0;
+
+                for (int digit = 0; digit < size; digit++) {
+                    if (digits[digit] == 0) {
+                        continue;
+                    }
+
+                    auto square = squares[digit];
+                    auto positional = square_values[square];
+                    auto corner = adjacent_corner(square);
+                    auto corner_digit = std::find(squares.begin(), squares.begin() + size, corner) - squares.begin();
+
+                    if (corner >= 0 && corner_digit < size && digits[corner_digit] != 0) {
+                        positional = settled_value;
+                    }
+
+                    auto cell = (1 - weight_of_discs) * positional + weight_of_discs * eval_scale;
+                    value += (digits[digit] == 1 ? cell : -cell) / coverage[square];
+                }
+
+                _storage[phase * phase_weights + pattern_offsets[pattern] + index] =
+                    static_cast<std::int16_t>(std::lround(value));
+            }
+        }
+    }
+
+    _weights = _storage.data();
+}
+
+PatternEvaluator::PatternEvaluator(const std::string &path) : _file{std::make_unique<MappedFile>(path)} {
+    WeightHeader expected{.weights = static_cast<std::uint32_t>(weight_count())};
+    WeightHeader header;
+
+    if (_file->size() != sizeof(header) + weight_count() * sizeof(std::int16_t)) {
+        throw std::runtime_error(path + " does not hold weights for these patterns");
+    }
+
+    std::memcpy(&header, _file->data(), sizeof(header));
+
+    if (std::memcmp(&header, &expected, sizeof(header)) != 0) {
+        throw std::runtime_error(path + " does not hold weights for these patterns");
+    }
+
+    _weights = reinterpret_cast<const std::int16_t *>(_file->data() + sizeof(header));
+}
+
+int PatternEvaluator::evaluate(const Board &board, Piece piece) const {
+    return evaluate(feature_indices(board), phase(board), piece);
+}
+
+int PatternEvaluator::evaluate(const FeatureIndices &indices, int phase, Piece piece) const {
+    const auto *weights = _weights + phase * phase_weights;
+    int score = 0;
+
+    for (int i = 0; i < feature_count; i++) {
+        score += weights[feature_offsets[i] + indices[i]];
+    }
+
+    // Nothing is worth more than owning every disc, which keeps evaluations apart from finished game scores
+    score = std::clamp(score, -64 * eval_scale, 64 * eval_scale);
+
+    return piece == Piece::Black ? score : -score;
+}
+
+int PatternEvaluator::evaluate(const EvalState &state, Piece piece) const {
+    return evaluate(state.indices(), state.phase(), piece);
+}
+
+std::int16_t PatternEvaluator::weight(int phase, Pattern pattern, std::uint32_t index) const {
+    return _weights[phase * phase_weights + pattern_offsets[static_cast<int>(pattern)] + index];
+}
+
+std::span<const std::int16_t> PatternEvaluator::weights() const {
+    return {_weights, weight_count()};
+}
+
+
+bool write_weights(const std::string &path, std::span<const std::int16_t> weights) {
+    if (weights.size() != weight_count()) {
+        return false;
+    }
+
+    WeightHeader header{.weights = static_cast<std::uint32_t>(weights.size())};
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(weights.data()), static_cast<std::streamsize>(weights.size_bytes()));
+
+    return file.good();
+}
+
+
+const PatternEvaluator &default_evaluator() {
+    static const PatternEvaluator evaluator;
+    return evaluator;
+}
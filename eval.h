@@ -0,0 +1,139 @@
+#ifndef REVERSI_EVAL_H
+#define REVERSI_EVAL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "reversi.h"
+
+
+enum class Evaluation {
+    // Disc difference, in discs
+    Discs,
+    // Pattern tables, in 1/eval_scale discs
+    Patterns,
+};
+
+constexpr int eval_scale = 8;
+
+
+enum class Pattern {
+    // Edge row plus the two X-squares next to its corners
+    Edge2X,
+    Corner3x3,
+    Corner2x5,
+    Diagonal4,
+    Diagonal5,
+    Diagonal6,
+    Diagonal7,
+    Diagonal8,
+};
+
+constexpr int pattern_count = 8;
+
+// Every symmetric placement of each pattern on the board
+constexpr int feature_count = 34;
+
+constexpr int max_pattern_size = 10;
+
+// Weights change as the board fills up, by groups of five discs
+constexpr int phase_count = 12;
+
+
+struct Feature {
+    Pattern pattern{Pattern::Edge2X};
+    int size{0};
+    // Square (row * 8 + column) of each ternary digit, lowest digit first
+    std::array<int, max_pattern_size> squares{};
+};
+
+
+// Ternary index of a pattern configuration: digit 0 for an empty cell, 1 for black, 2 for white
+using FeatureIndices = std::array<std::uint32_t, feature_count>;
+
+
+[[nodiscard]] const std::array<Feature, feature_count> &features();
+
+[[nodiscard]] int pattern_size(Pattern pattern);
+
+[[nodiscard]] int phase(const Board &board);
+
+[[nodiscard]] int phase(std::uint64_t black, std::uint64_t white);
+
+// Indices of all features at once, summed from tables of each row's contribution
+[[nodiscard]] FeatureIndices feature_indices(const Board &board);
+
+[[nodiscard]] FeatureIndices feature_indices(std::uint64_t black, std::uint64_t white);
+
+// Weights of all phases, one table per pattern and phase
+[[nodiscard]] std::size_t weight_count();
+
+// Position in the weights of the table feature reads in phase, the weight of a configuration is at offset + index
+[[nodiscard]] std::size_t weight_offset(int phase, int feature);
+
+
+// Feature indices kept up to date move by move. Every cell lists the features it belongs to with the power of three
+// of its digit, so a move only touches the features of the placed and flipped cells.
+class EvalState {
+public:
+    explicit EvalState(const Board &board);
+
+    // Applies a move made on the board, undo as returned by Board::make. Illegal moves change nothing, as on the board
+    void update(const UndoInfo &undo);
+
+    // Takes back a move given to update, in reverse order of the updates
+    void restore(const UndoInfo &undo);
+
+    [[nodiscard]] const FeatureIndices &indices() const;
+
+    [[nodiscard]] int phase() const;
+
+private:
+    FeatureIndices _indices{};
+    int _discs{0};
+};
+
+
+class PatternEvaluator {
+public:
+    // Hand-made weights: a square table valuing corners and penalising the cells next to them, blending into the
+    // plain disc count as the game nears its end
+    PatternEvaluator();
+
+    // Maps a weight file written by write_weights. Throws std::runtime_error if it can't be mapped or was written
+    // for other patterns.
+    explicit PatternEvaluator(const std::string &path);
+
+    // From the side of piece, in 1/eval_scale discs, always strictly between -win_score and win_score
+    [[nodiscard]] int evaluate(const Board &board, Piece piece) const;
+
+    [[nodiscard]] int evaluate(const FeatureIndices &indices, int phase, Piece piece) const;
+
+    [[nodiscard]] int evaluate(const EvalState &state, Piece piece) const;
+
+    [[nodiscard]] std::int16_t weight(int phase, Pattern pattern, std::uint32_t index) const;
+
+    [[nodiscard]] std::span<const std::int16_t> weights() const;
+
+private:
+    // Per phase, every pattern's configurations one after another. Points into _storage or _file.
+    const std::int16_t *_weights{nullptr};
+    std::vector<std::int16_t> _storage{};
+    std::unique_ptr<MappedFile> _file{};
+};
+
+
+// Writes weights laid out as PatternEvaluator::weights, false if the file can't be written
+bool write_weights(const std::string &path, std::span<const std::int16_t> weights);
+
+
+// Shared evaluator with the default weights
+[[nodiscard]] const PatternEvaluator &default_evaluator();
+
+#endif //REVERSI_EVAL_H
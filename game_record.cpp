@@ -0,0 +1,126 @@
+#include "game_record.h"
+
+#include <bit>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+constexpr char game_magic[8] = {'R', 'V', 'G', 'A', 'M', 'E', 0, 1};
+
+static_assert(sizeof(GameRecordHeader) == 8 && std::endian::native == std::endian::little);
+static_assert(std::forward_iterator<GameRecordReader::Iterator>);
+
+
+int final_black_score(int black_discs, int white_discs) {
+    auto difference = black_discs - white_discs;
+    auto empties = 64 - black_discs - white_discs;
+    return difference > 0 ? difference + empties : difference < 0 ? difference - empties : 0;
+}
+
+
+void GameRecord::add(const Move &move) {
+    moves.push_back(static_cast<std::uint8_t>(move.row * 8 + move.column));
+    header.move_count = static_cast<std::uint8_t>(moves.size());
+}
+
+void GameRecord::finish(const Board &board) {
+    auto score = final_black_score(board.score(Piece::Black), board.score(Piece::White));
+    header.black_score = static_cast<std::int8_t>(score);
+}
+
+
+bool play_record(Game &game, std::span<const std::uint8_t> moves) {
+    for (auto square: moves) {
+        if (square >= 64 || game.next_move(game.current_turn(), square / 8, square % 8) == MoveStatus::Error) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+GameRecordWriter::GameRecordWriter(const std::string &path) : _file{path, std::ios::binary | std::ios::trunc} {
+    if (!_file) {
+        throw std::runtime_error("can't create " + path);
+    }
+
+    _file.write(game_magic, sizeof(game_magic));
+}
+
+void GameRecordWriter::write(const GameRecordHeader &header, std::span<const std::uint8_t> moves) {
+    auto written = header;
+    written.move_count = static_cast<std::uint8_t>(moves.size());
+
+    _file.write(reinterpret_cast<const char *>(&written), sizeof(written));
+    _file.write(reinterpret_cast<const char *>(moves.data()), static_cast<std::streamsize>(moves.size()));
+}
+
+void GameRecordWriter::write(const GameRecord &record) {
+    write(record.header, record.moves);
+}
+
+bool GameRecordWriter::good() const {
+    return _file.good();
+}
+
+
+GameRecordReader::Iterator::Iterator(const std::byte *position, const std::byte *end)
+    : _position{position}, _end{end} {
+    load();
+}
+
+void GameRecordReader::Iterator::load() {
+    auto remaining = static_cast<std::size_t>(_end - _position);
+
+    if (remaining >= sizeof(GameRecordHeader)) {
+        std::memcpy(&_view.header, _position, sizeof(GameRecordHeader));
+
+        if (remaining - sizeof(GameRecordHeader) >= _view.header.move_count) {
+            const auto *moves = reinterpret_cast<const std::uint8_t *>(_position + sizeof(GameRecordHeader));
+            _view.moves = {moves, _view.header.move_count};
+            return;
+        }
+    }
+
+    *this = Iterator{};
+}
+
+const GameRecordView &GameRecordReader::Iterator::operator*() const {
+    return _view;
+}
+
+const GameRecordView *GameRecordReader::Iterator::operator->() const {
+    return &_view;
+}
+
+GameRecordReader::Iterator &GameRecordReader::Iterator::operator++() {
+    _position += sizeof(GameRecordHeader) + _view.header.move_count;
+    load();
+    return *this;
+}
+
+GameRecordReader::Iterator GameRecordReader::Iterator::operator++(int) {
+    auto previous = *this;
+    ++*this;
+    return previous;
+}
+
+bool GameRecordReader::Iterator::operator==(const Iterator &other) const {
+    return _position == other._position;
+}
+
+
+GameRecordReader::GameRecordReader(const std::string &path) : _file{std::make_unique<MappedFile>(path)} {
+    if (_file->size() < sizeof(game_magic) || std::memcmp(_file->data(), game_magic, sizeof(game_magic)) != 0) {
+        throw std::runtime_error(path + " is not a game file");
+    }
+}
+
+GameRecordReader::Iterator GameRecordReader::begin() const {
+    return {_file->data() + sizeof(game_magic), _file->data() + _file->size()};
+}
+
+GameRecordReader::Iterator GameRecordReader::end() const {
+    return {};
+}
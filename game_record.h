@@ -0,0 +1,128 @@
+#ifndef REVERSI_GAME_RECORD_H
+#define REVERSI_GAME_RECORD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "reversi.h"
+
+// Game files: an 8-byte file header, then per game an 8-byte GameRecordHeader followed by one byte per move holding
+// its square (row * 8 + column). Passes are implied as in Game::next_move. Multi-byte fields are little-endian.
+
+
+enum class GameSource : std::uint8_t {
+    Unknown,
+    SelfPlay,
+    Wthor,
+    Ggf,
+};
+
+
+struct GameRecordHeader {
+    std::uint8_t move_count{0};
+    // Final disc difference from black's side with the empty cells counted for the winner, as in WTHOR. Games stopped
+    // before the end keep the result recorded by their source.
+    std::int8_t black_score{0};
+    GameSource source{GameSource::Unknown};
+    // Leading moves not chosen by the players, such as a randomized opening
+    std::uint8_t opening_moves{0};
+    // Player numbers, their meaning is up to the source
+    std::uint16_t black_player{0};
+    std::uint16_t white_player{0};
+};
+
+
+// Disc difference from black's side at the end of a game, empty cells going to the winner and split on a draw
+[[nodiscard]] int final_black_score(int black_discs, int white_discs);
+
+
+// A game being played, built move by move alongside Game::next_move
+struct GameRecord {
+    GameRecordHeader header{};
+    std::vector<std::uint8_t> moves{};
+
+    void add(const Move &move);
+
+    // Sets the final score from the board of a finished game
+    void finish(const Board &board);
+};
+
+
+// Borrowed from the mapped file, valid as long as the reader
+struct GameRecordView {
+    GameRecordHeader header{};
+    std::span<const std::uint8_t> moves{};
+};
+
+
+// Plays the moves of a record from the standard start, false at the first illegal move
+bool play_record(Game &game, std::span<const std::uint8_t> moves);
+
+
+class GameRecordWriter {
+public:
+    // Throws std::runtime_error if the file can't be created
+    explicit GameRecordWriter(const std::string &path);
+
+    void write(const GameRecordHeader &header, std::span<const std::uint8_t> moves);
+
+    void write(const GameRecord &record);
+
+    // False once any write failed
+    [[nodiscard]] bool good() const;
+
+private:
+    std::ofstream _file;
+};
+
+
+// Walks a memory-mapped game file record by record without copying or allocating. A truncated last record ends the
+// iteration early.
+class GameRecordReader {
+public:
+    class Iterator {
+    public:
+        using value_type = GameRecordView;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+
+        Iterator(const std::byte *position, const std::byte *end);
+
+        const GameRecordView &operator*() const;
+
+        const GameRecordView *operator->() const;
+
+        Iterator &operator++();
+
+        Iterator operator++(int);
+
+        bool operator==(const Iterator &other) const;
+
+    private:
+        // Reads the record at _position, or becomes the end iterator if none fits
+        void load();
+
+        const std::byte *_position{nullptr};
+        const std::byte *_end{nullptr};
+        GameRecordView _view{};
+    };
+
+    // Throws std::runtime_error if the file can't be mapped or has no game header
+    explicit GameRecordReader(const std::string &path);
+
+    [[nodiscard]] Iterator begin() const;
+
+    [[nodiscard]] Iterator end() const;
+
+private:
+    std::unique_ptr<MappedFile> _file;
+};
+
+#endif //REVERSI_GAME_RECORD_H
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "game_record.h"
+#include "importers.h"
+#include "mapped_file.h"
+#include "positions.h"
+
+// Converts WTHOR (.wtb) and GGF databases into game records and labelled positions. Input files are memory-mapped and
+// cut into games, which worker threads validate by replaying them. Output keeps the order of the input, one block of
+// games at a time so memory stays bounded however large the archive.
+
+struct Input {
+    bool ggf{false};
+    std::string path{};
+};
+
+struct Options {
+    std::vector<Input> inputs{};
+    // Game records, none written if empty
+    std::string games{};
+    // Labelled positions, none written if empty
+    std::string positions{};
+    int threads{static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u))};
+};
+
+// Games validated together before their block is written
+constexpr std::size_t block_games = 1 << 16;
+
+// Games a worker takes at a time from its block
+constexpr std::size_t worker_games = 256;
+
+struct ImportedGame {
+    ImportError error{ImportError::None};
+    GameRecord record{};
+    std::vector<LabelledPosition> positions{};
+};
+
+struct ImportTotals {
+    std::uint64_t games{0};
+    std::uint64_t moves{0};
+    // Indexed by ImportError
+    std::uint64_t errors[5]{};
+};
+
+class Importer {
+public:
+    explicit Importer(const Options &options) : _threads{std::max(options.threads, 1)} {
+        if (!options.games.empty()) {
+            _games.emplace(options.games);
+        }
+
+        if (!options.positions.empty()) {
+            _positions.emplace(options.positions);
+        }
+    }
+
+    [[nodiscard]] bool good() const {
+        return (!_games || _games->good()) && (!_positions || _positions->good());
+    }
+
+    // import_game turns game number i of the file into a record
+    void run(std::size_t count, const std::function<ImportError(std::size_t, GameRecord &)> &import_game) {
+        std::vector<ImportedGame> block;
+
+        for (std::size_t first = 0; first < count; first += block_games) {
+            block.resize(std::min(block_games, count - first));
+            std::atomic<std::size_t> next{0};
+            std::vector<std::thread> workers;
+
+            for (int thread = 0; thread < _threads; thread++) {
+                workers.emplace_back([&] {
+                    for (auto start = next.fetch_add(worker_games); start < block.size();
+                         start = next.fetch_add(worker_games)) {
+                        for (auto i = start; i < std::min(start + worker_games, block.size()); i++) {
+                            auto &game = block[i];
+                            game.positions.clear();
+                            game.error = import_game(first + i, game.record);
+
+                            if (game.error == ImportError::None && _positions) {
+                                record_positions(game.record, game.positions);
+                            }
+                        }
+                    }
+                });
+            }
+
+            for (auto &worker: workers) {
+                worker.join();
+            }
+
+            write(block);
+        }
+    }
+
+    [[nodiscard]] const ImportTotals &totals() const {
+        return _totals;
+    }
+
+private:
+    void write(const std::vector<ImportedGame> &block) {
+        for (const auto &game: block) {
+            _totals.games++;
+            _totals.errors[static_cast<int>(game.error)]++;
+
+            if (game.error != ImportError::None) {
+                continue;
+            }
+
+            _totals.moves += game.record.moves.size();
+
+            if (_games) {
+                _games->write(game.record);
+            }
+
+            if (_positions) {
+                for (const auto &position: game.positions) {
+                    _positions->write(position);
+                }
+            }
+        }
+    }
+
+    int _threads{1};
+    std::optional<GameRecordWriter> _games{};
+    std::optional<PositionWriter> _positions{};
+    ImportTotals _totals{};
+};
+
+bool import_file(Importer &importer, const Input &input) {
+    std::unique_ptr<MappedFile> file;
+
+    try {
+        file = std::make_unique<MappedFile>(input.path);
+    } catch (const std::runtime_error &error) {
+        std::cerr << error.what() << std::endl;
+        return false;
+    }
+
+    auto bytes = std::span<const std::byte>{file->data(), file->size()};
+
+    if (input.ggf) {
+        auto text = std::string_view{reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+        auto games = split_ggf_games(text);
+
+        importer.run(games.size(), [&](std::size_t i, GameRecord &record) {
+            return import_ggf_game(games[i], record);
+        });
+
+        return true;
+    }
+
+    WthorFileHeader header;
+
+    if (!parse_wthor_header(bytes, header)) {
+        std::cerr << input.path << " is not a WTHOR file of 8x8 games" << std::endl;
+        return false;
+    }
+
+    // Trust the file size over the header count if they disagree
+    auto count = std::min<std::size_t>(header.games, (bytes.size() - wthor_header_size) / wthor_game_size);
+
+    importer.run(count, [&](std::size_t i, GameRecord &record) {
+        return import_wthor_game(bytes.subspan(wthor_header_size + i * wthor_game_size, wthor_game_size), record);
+    });
+
+    return true;
+}
+
+bool parse_options(int argc, char *argv[], Options &options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        auto option = std::string{argv[i]};
+
+        try {
+            if (option == "--wthor") {
+                options.inputs.push_back(Input{.ggf = false, .path = argv[i + 1]});
+            } else if (option == "--ggf") {
+                options.inputs.push_back(Input{.ggf = true, .path = argv[i + 1]});
+            } else if (option == "--games") {
+                options.games = argv[i + 1];
+            } else if (option == "--positions") {
+                options.positions = argv[i + 1];
+            } else if (option == "--threads") {
+                options.threads = std::stoi(argv[i + 1]);
+            } else {
+                return false;
+            }
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    return argc % 2 == 1 && !options.inputs.empty() && !(options.games.empty() && options.positions.empty());
+}
+
+int main(int argc, char *argv[]) {
+    auto options = Options{};
+
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " (--wthor <path> | --ggf <path>)... [--games <path>]"
+                  << " [--positions <path>] [--threads <threads>]" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<Importer> importer;
+
+    try {
+        importer = std::make_unique<Importer>(options);
+    } catch (const std::runtime_error &error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (const auto &input: options.inputs) {
+        if (!import_file(*importer, input)) {
+            return 1;
+        }
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto &totals = importer->totals();
+
+    std::printf(
+        "%llu games in %.2f s, %.0f games/s\n", static_cast<unsigned long long>(totals.games), seconds,
+        static_cast<double>(totals.games) / seconds
+    );
+    std::printf(
+        "imported %llu (%llu moves), malformed %llu, unsupported %llu, illegal moves %llu, score mismatches %llu\n",
+        static_cast<unsigned long long>(totals.errors[static_cast<int>(ImportError::None)]),
+        static_cast<unsigned long long>(totals.moves),
+        static_cast<unsigned long long>(totals.errors[static_cast<int>(ImportError::Malformed)]),
+        static_cast<unsigned long long>(totals.errors[static_cast<int>(ImportError::Unsupported)]),
+        static_cast<unsigned long long>(totals.errors[static_cast<int>(ImportError::IllegalMove)]),
+        static_cast<unsigned long long>(totals.errors[static_cast<int>(ImportError::ScoreMismatch)])
+    );
+
+    if (!importer->good()) {
+        std::cerr << "Can't write the output" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,332 @@
+#include "importers.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+
+#include "bitboard.h"
+
+// Replays moves on raw bitboards through the move kernels, without the hashing and move counting of Board and Game.
+// Passes are implied the same way as in Game::next_move.
+class Replay {
+public:
+    Replay() : _black{Board{}.discs(Piece::Black)}, _white{Board{}.discs(Piece::White)} {}
+
+    [[nodiscard]] Piece to_move() const {
+        return _to_move;
+    }
+
+    [[nodiscard]] bool finished() const {
+        return _finished;
+    }
+
+    [[nodiscard]] std::uint64_t discs(Piece piece) const {
+        return piece == Piece::Black ? _black : _white;
+    }
+
+    // False if the side to move can't play square
+    bool play(int square) {
+        if (_finished || square < 0 || square >= 64) {
+            return false;
+        }
+
+        auto &own = _to_move == Piece::Black ? _black : _white;
+        auto &enemy = _to_move == Piece::Black ? _white : _black;
+        auto move = std::uint64_t{1} << square;
+
+        if (((own | enemy) & move) != 0) {
+            return false;
+        }
+
+        auto flipped = flip_mask(own, enemy, move);
+
+        if (flipped == 0) {
+            return false;
+        }
+
+        own |= flipped | move;
+        enemy &= ~flipped;
+
+        if (legal_move_mask(enemy, own) != 0) {
+            _to_move = opponent(_to_move);
+        } else if (legal_move_mask(own, enemy) == 0) {
+            _finished = true;
+        }
+
+        return true;
+    }
+
+private:
+    std::uint64_t _black{0};
+    std::uint64_t _white{0};
+    Piece _to_move{Piece::Black};
+    bool _finished{false};
+};
+
+
+std::uint16_t read_u16(const std::byte *data) {
+    return static_cast<std::uint16_t>(std::to_integer<unsigned>(data[0]) | std::to_integer<unsigned>(data[1]) << 8);
+}
+
+bool parse_wthor_header(std::span<const std::byte> file, WthorFileHeader &header) {
+    if (file.size() < wthor_header_size) {
+        return false;
+    }
+
+    header.games = read_u16(file.data() + 4) | static_cast<std::uint32_t>(read_u16(file.data() + 6)) << 16;
+    header.year = read_u16(file.data() + 10);
+
+    // Board size 0 is the old way of writing 8, type 0 is games as opposed to solitaires
+    auto board_size = std::to_integer<int>(file[12]);
+    auto type = std::to_integer<int>(file[13]);
+
+    return (board_size == 0 || board_size == 8) && type == 0;
+}
+
+ImportError import_wthor_game(std::span<const std::byte> game, GameRecord &record) {
+    if (game.size() != wthor_game_size) {
+        return ImportError::Malformed;
+    }
+
+    record = GameRecord{};
+    record.header.source = GameSource::Wthor;
+    record.header.black_player = read_u16(game.data() + 2);
+    record.header.white_player = read_u16(game.data() + 4);
+
+    Replay replay;
+
+    for (std::size_t i = 8; i < wthor_game_size; i++) {
+        auto code = std::to_integer<int>(game[i]);
+
+        if (code == 0) {
+            break;
+        }
+
+        auto row = code / 10 - 1;
+        auto column = code % 10 - 1;
+
+        if (row < 0 || row >= 8 || column < 0 || column >= 8) {
+            return ImportError::Malformed;
+        }
+
+        auto piece = replay.to_move();
+
+        if (!replay.play(row * 8 + column)) {
+            return ImportError::IllegalMove;
+        }
+
+        record.add(Move{.piece = piece, .row = row, .column = column});
+    }
+
+    auto recorded_black = std::to_integer<int>(game[6]);
+
+    if (recorded_black > 64) {
+        return ImportError::Malformed;
+    }
+
+    if (!replay.finished()) {
+        record.header.black_score = static_cast<std::int8_t>(recorded_black * 2 - 64);
+        return ImportError::None;
+    }
+
+    auto black = std::popcount(replay.discs(Piece::Black));
+    auto white = std::popcount(replay.discs(Piece::White));
+    auto empties = 64 - black - white;
+    auto expected_black = black > white ? black + empties : black < white ? black : black + empties / 2;
+
+    if (recorded_black != expected_black) {
+        return ImportError::ScoreMismatch;
+    }
+
+    record.header.black_score = static_cast<std::int8_t>(final_black_score(black, white));
+    return ImportError::None;
+}
+
+
+std::vector<std::string_view> split_ggf_games(std::string_view text) {
+    std::vector<std::string_view> games;
+
+    for (auto start = text.find("(;"); start != std::string_view::npos; start = text.find("(;", start)) {
+        auto end = text.find(";)", start + 2);
+
+        if (end == std::string_view::npos) {
+            games.push_back(text.substr(start));
+            break;
+        }
+
+        games.push_back(text.substr(start, end + 2 - start));
+        start = end + 2;
+    }
+
+    return games;
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Board of a BO property, "8" then 64 cells of -, * or O row by row, then the side to move
+bool is_standard_start(std::string_view board) {
+    std::string cells;
+
+    for (auto c: board) {
+        if (!is_space(c)) {
+            cells.push_back(c);
+        }
+    }
+
+    if (cells.size() != 66 || cells[0] != '8' || cells[65] != '*') {
+        return false;
+    }
+
+    auto start = Board{};
+
+    for (int square = 0; square < 64; square++) {
+        auto cell = start.get(square / 8, square % 8);
+        auto expected = cell == Cell::Black ? '*' : cell == Cell::White ? 'O' : '-';
+
+        if (cells[square + 1] != expected) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+ImportError import_ggf_game(std::string_view game, GameRecord &record) {
+    if (!game.starts_with("(;") || !game.ends_with(";)")) {
+        return ImportError::Malformed;
+    }
+
+    record = GameRecord{};
+    record.header.source = GameSource::Ggf;
+
+    Replay replay;
+    auto standard_start = false;
+    auto has_result = false;
+    double result = 0;
+
+    for (std::size_t position = 2; position < game.size() - 2;) {
+        if (is_space(game[position])) {
+            position++;
+            continue;
+        }
+
+        auto open = game.find('[', position);
+        auto close = open == std::string_view::npos ? open : game.find(']', open);
+
+        if (close == std::string_view::npos) {
+            return ImportError::Malformed;
+        }
+
+        auto key = game.substr(position, open - position);
+        auto value = game.substr(open + 1, close - open - 1);
+        position = close + 1;
+
+        if (key == "GM" && value != "Othello") {
+            return ImportError::Unsupported;
+        }
+
+        if (key == "TY" && value != "8") {
+            return ImportError::Unsupported;
+        }
+
+        if (key == "BO") {
+            if (!is_standard_start(value)) {
+                return ImportError::Unsupported;
+            }
+
+            standard_start = true;
+        }
+
+        if (key == "RE") {
+            auto sign = value.starts_with('-') ? -1.0 : 1.0;
+            auto digits = value.substr(value.starts_with('+') || value.starts_with('-') ? 1 : 0);
+            // Anything but a number, such as "?", is no result
+            auto parsed = std::from_chars(digits.data(), digits.data() + digits.size(), result);
+            has_result = parsed.ec == std::errc{};
+            result *= sign;
+        }
+
+        if (key == "B" || key == "W") {
+            if (!standard_start) {
+                return ImportError::Malformed;
+            }
+
+            auto piece = key == "B" ? Piece::Black : Piece::White;
+            auto text = value.substr(0, value.find('/'));
+
+            if (text.size() != 2) {
+                return ImportError::Malformed;
+            }
+
+            // Passes are already implied by the replay, a recorded one only has to agree with it
+            if ((text[0] | 0x20) == 'p' && (text[1] | 0x20) == 'a') {
+                if (replay.to_move() == piece && !replay.finished()) {
+                    return ImportError::IllegalMove;
+                }
+
+                continue;
+            }
+
+            auto column = (text[0] | 0x20) - 'a';
+            auto row = text[1] - '1';
+
+            if (row < 0 || row >= 8 || column < 0 || column >= 8) {
+                return ImportError::Malformed;
+            }
+
+            if (replay.to_move() != piece || !replay.play(row * 8 + column)) {
+                return ImportError::IllegalMove;
+            }
+
+            record.add(Move{.piece = piece, .row = row, .column = column});
+        }
+    }
+
+    if (!standard_start) {
+        return ImportError::Unsupported;
+    }
+
+    if (replay.finished()) {
+        auto black = std::popcount(replay.discs(Piece::Black));
+        auto white = std::popcount(replay.discs(Piece::White));
+        auto difference = black - white;
+        auto score = final_black_score(black, white);
+
+        // Servers may or may not give the empty cells to the winner
+        if (has_result && std::lround(result) != difference && std::lround(result) != score) {
+            return ImportError::ScoreMismatch;
+        }
+
+        record.header.black_score = static_cast<std::int8_t>(score);
+        return ImportError::None;
+    }
+
+    // Resigned or timed out, the result says who won
+    if (!has_result) {
+        return ImportError::Malformed;
+    }
+
+    record.header.black_score = static_cast<std::int8_t>(std::clamp(std::lround(result), -64L, 64L));
+    return ImportError::None;
+}
+
+
+void record_positions(const GameRecord &record, std::vector<LabelledPosition> &positions) {
+    Replay replay;
+
+    for (auto square: record.moves) {
+        positions.push_back(LabelledPosition{
+            .black = replay.discs(Piece::Black),
+            .white = replay.discs(Piece::White),
+            .score = record.header.black_score,
+        });
+
+        if (!replay.play(square)) {
+            positions.pop_back();
+            return;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef REVERSI_IMPORTERS_H
+#define REVERSI_IMPORTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "game_record.h"
+#include "positions.h"
+
+// Readers for the WTHOR and GGF game databases. Every game is replayed from the standard start on raw bitboards
+// before it is accepted, so a record produced here always replays with play_record.
+
+
+enum class ImportError {
+    None,
+    // Not a game in the expected layout
+    Malformed,
+    // Other board sizes, variants or start positions
+    Unsupported,
+    IllegalMove,
+    // The recorded result disagrees with the final board
+    ScoreMismatch,
+};
+
+
+constexpr std::size_t wthor_header_size = 16;
+
+constexpr std::size_t wthor_game_size = 68;
+
+
+struct WthorFileHeader {
+    std::uint32_t games{0};
+    std::uint16_t year{0};
+};
+
+
+// Reads the header of a .wtb game file, false if it is too short or holds anything but 8x8 games
+bool parse_wthor_header(std::span<const std::byte> file, WthorFileHeader &header);
+
+// One 68-byte game: tournament, black and white player numbers, black's disc count with the empty cells going to the
+// winner, theoretical score, then 60 moves coded as 10 * row + column counting from 1, zero after the last move.
+// Games stopped before the end keep the recorded result.
+ImportError import_wthor_game(std::span<const std::byte> game, GameRecord &record);
+
+// Text of each game of a GGF file, from "(;" to ";)"
+std::vector<std::string_view> split_ggf_games(std::string_view text);
+
+// One GGF game such as "(;GM[Othello]TY[8]BO[8 ... *]B[d3]W[c5//1.2]...RE[+4.000];)". Moves may carry an
+// evaluation and time after a slash, passes are written "pa". Only standard 8x8 games from the usual start are
+// supported.
+ImportError import_ggf_game(std::string_view game, GameRecord &record);
+
+// Appends the position before every move of a valid record, labelled with its score
+void record_positions(const GameRecord &record, std::vector<LabelledPosition> &positions);
+
+#endif //REVERSI_IMPORTERS_H
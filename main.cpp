@@ -1,6 +1,15 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include <map>
+#include <memory>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include "mcts.h"
 #include "reversi.h"
+#include "search.h"
+#include "thread_pool.h"
 
 
 void print_board(const Board &board) {
@@ -25,9 +34,77 @@ void print_board(const Board &board) {
     }
 }
 
-int main() {
+// Set by Ctrl-C while the CPU thinks
+std::atomic<bool> move_now{false};
+
+void request_move_now(int) {
+    move_now = true;
+}
+
+std::string move_text(const Move &move) {
+    return {static_cast<char>('A' + move.column), static_cast<char>('1' + move.row)};
+}
+
+struct Options {
+    SearchOptions search{};
+    // The CPU plays by MCTS with this many playouts per move instead of searching, if not 0
+    std::uint64_t playouts{0};
+    // The searching CPU keeps searching while the human thinks
+    bool ponder{true};
+};
+
+bool parse_options(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; i++) {
+        auto option = std::string{argv[i]};
+
+        if (i + 1 >= argc) {
+            return false;
+        }
+
+        try {
+            if (option == "--hash-mb") {
+                options.search.hash_mb = std::stoul(argv[++i]);
+            } else if (option == "--threads") {
+                options.search.threads = std::stoi(argv[++i]);
+            } else if (option == "--weights") {
+                options.search.evaluator = std::make_shared<const PatternEvaluator>(argv[++i]);
+            } else if (option == "--book") {
+                options.search.book = std::make_shared<const OpeningBook>(argv[++i]);
+            } else if (option == "--playouts") {
+                options.playouts = std::stoull(argv[++i]);
+            } else if (option == "--ponder") {
+                auto value = std::string{argv[++i]};
+
+                if (value != "on" && value != "off") {
+                    return false;
+                }
+
+                options.ponder = value == "on";
+            } else {
+                return false;
+            }
+        } catch (const std::runtime_error &error) {
+            std::cerr << error.what() << std::endl;
+            return false;
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[]) {
     //Game of reversi with options of CPU vs Human, and Human vs Human (2 players)
 
+    auto options = Options{};
+
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--hash-mb <megabytes>] [--threads <threads>] [--weights <path>]"
+                  << " [--book <path>] [--playouts <playouts>] [--ponder on|off]" << std::endl;
+        return 1;
+    }
+
     Game game;
 
     std::cout << "Welcome to Reversi!" << std::endl;
@@ -40,18 +117,34 @@ int main() {
     std::cin >> players_choice;
 
     std::map<Piece, std::unique_ptr<Player>> players;
+    auto make_cpu = [&](Piece piece) -> std::unique_ptr<Player> {
+        if (options.playouts != 0) {
+            auto mcts_options = MctsOptions{.threads = options.search.threads};
+            return std::make_unique<MctsPlayer>(piece, MctsLimits{.playouts = options.playouts}, mcts_options);
+        }
+
+        auto cpu_limits = SearchLimits{.depth = 60, .time = std::chrono::milliseconds{1000}};
+        return std::make_unique<SearchPlayer>(piece, cpu_limits, options.search);
+    };
 
     if (players_choice == 0) {
-        players[Piece::Black] = std::make_unique<CpuPlayer>(Piece::Black);
-        players[Piece::White] = std::make_unique<CpuPlayer>(Piece::White);
+        players[Piece::Black] = make_cpu(Piece::Black);
+        players[Piece::White] = make_cpu(Piece::White);
     } else if (players_choice == 1) {
         players[Piece::Black] = std::make_unique<HumanPlayer>(Piece::Black);
-        players[Piece::White] = std::make_unique<CpuPlayer>(Piece::White);
+        players[Piece::White] = make_cpu(Piece::White);
     } else if (players_choice == 2) {
         players[Piece::Black] = std::make_unique<HumanPlayer>(Piece::Black);
         players[Piece::White] = std::make_unique<HumanPlayer>(Piece::White);
     }
 
+    // Moves are chosen on the pool while this thread waits for them, both players take turns on its one thread
+    ThreadPool pool{1};
+
+    if (players_choice != 2) {
+        std::cout << "Press Ctrl-C while the CPU thinks to make it move at once" << std::endl;
+    }
+
     print_board(game.board());
     auto black_score = game.board().score(Piece::Black);
     auto white_score = game.board().score(Piece::White);
@@ -63,9 +156,64 @@ int main() {
         std::cout << "Move " << game.move_count() + 1 << std::endl;
         std::cout << "Current turn: " << (game.current_turn() == Piece::Black ? "Black" : "White") << std::endl;
 
-        auto move = players[game.current_turn()]->get_next_move(game);
+        // The CPU shows its best move so far as it searches, the line is finished once the move is chosen
+        auto show_progress = [](const MoveProgress &progress) {
+            std::cout << "\rThinking: depth " << progress.depth << ", best " << move_text(progress.move) << "   "
+                      << std::flush;
+        };
+        auto human = dynamic_cast<const HumanPlayer *>(players[game.current_turn()].get()) != nullptr;
+        std::stop_source stop;
+
+        // Ctrl-C only stops the CPU, it quits as usual while a human is to move
+        if (!human) {
+            move_now = false;
+            std::signal(SIGINT, request_move_now);
+        }
+
+        auto pending = players[game.current_turn()]->get_next_move_async(
+            game, pool, stop.get_token(), human ? ProgressCallback{} : ProgressCallback{show_progress}
+        );
+
+        while (pending.wait_for(std::chrono::milliseconds{50}) != std::future_status::ready) {
+            if (move_now && !stop.stop_requested()) {
+                stop.request_stop();
+            }
+        }
+
+        auto move = pending.get();
+
+        if (!human) {
+            std::signal(SIGINT, SIG_DFL);
+            std::cout << "\r" << (game.current_turn() == Piece::Black ? "Black" : "White") << " plays "
+                      << move_text(move) << (stop.stop_requested() ? " early, as asked" : "") << "                  "
+                      << std::endl;
+        } else if (!std::cin) {
+            std::cout << std::endl << "Input closed, game abandoned" << std::endl;
+            return 1;
+        }
         auto move_status = game.next_move(move.piece, move.row, move.column);
 
+        if (auto cpu = dynamic_cast<SearchPlayer *>(players[move.piece].get())) {
+            const auto &result = cpu->last_result();
+            std::cout << "CPU searched depth " << result.depth << ", " << result.nodes << " nodes in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(result.elapsed).count() << " ms"
+                      << (result.ponder_hit ? " after a ponder hit" : "") << std::endl;
+
+            // Human input blocks, so the CPU uses that time on the reply it expects
+            auto human_next = dynamic_cast<const HumanPlayer *>(players[game.current_turn()].get()) != nullptr;
+
+            if (options.ponder && move_status != MoveStatus::Error && human_next &&
+                game.status() == GameStatus::Continue) {
+                cpu->ponder(game);
+            }
+        } else if (auto mcts = dynamic_cast<const MctsPlayer *>(players[move.piece].get())) {
+            const auto &result = mcts->last_result();
+            std::cout << "CPU played " << result.playouts << " playouts in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(result.elapsed).count() << " ms, "
+                      << static_cast<std::uint64_t>(result.playouts_per_second()) << " playouts/s, kept "
+                      << result.reused_nodes << " of " << result.nodes << " nodes" << std::endl;
+        }
+
         if (move_status == MoveStatus::Error) {
             std::cout << "Invalid move!" << std::endl;
         }
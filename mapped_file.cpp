@@ -0,0 +1,86 @@
+#include "mapped_file.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define REVERSI_MMAP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef REVERSI_MMAP
+
+MappedFile::MappedFile(const std::string &path) {
+    auto descriptor = open(path.c_str(), O_RDONLY);
+
+    if (descriptor < 0) {
+        throw std::runtime_error("can't open " + path);
+    }
+
+    struct stat status{};
+
+    if (fstat(descriptor, &status) != 0) {
+        close(descriptor);
+        throw std::runtime_error("can't read the size of " + path);
+    }
+
+    _size = static_cast<std::size_t>(status.st_size);
+
+    // Mapping zero bytes fails, an empty file is simply an empty view
+    if (_size != 0) {
+        auto *mapped = mmap(nullptr, _size, PROT_READ, MAP_SHARED, descriptor, 0);
+
+        if (mapped == MAP_FAILED) {
+            close(descriptor);
+            throw std::runtime_error("can't map " + path);
+        }
+
+        _data = static_cast<const std::byte *>(mapped);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(descriptor);
+}
+
+MappedFile::~MappedFile() {
+    if (_data != nullptr) {
+        munmap(const_cast<std::byte *>(_data), _size);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+
+    if (!file) {
+        throw std::runtime_error("can't open " + path);
+    }
+
+    _contents.resize(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+
+    if (!file.read(reinterpret_cast<char *>(_contents.data()), static_cast<std::streamsize>(_contents.size()))) {
+        throw std::runtime_error("can't read " + path);
+    }
+
+    _data = _contents.data();
+    _size = _contents.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+#endif
+
+const std::byte *MappedFile::data() const {
+    return _data;
+}
+
+std::size_t MappedFile::size() const {
+    return _size;
+}
@@ -0,0 +1,32 @@
+#ifndef REVERSI_MAPPED_FILE_H
+#define REVERSI_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+// Read-only view of a whole file, memory-mapped where the platform allows it and read into memory otherwise
+class MappedFile {
+public:
+    // Throws std::runtime_error if the file can't be opened or mapped
+    explicit MappedFile(const std::string &path);
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    [[nodiscard]] const std::byte *data() const;
+
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    const std::byte *_data{nullptr};
+    std::size_t _size{0};
+    // Only used without memory mapping
+    std::vector<std::byte> _contents{};
+};
+
+#endif //REVERSI_MAPPED_FILE_H
@@ -0,0 +1,549 @@
+#include "mcts.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <thread>
+#include <vector>
+
+#include "bitboard.h"
+
+constexpr std::uint8_t pass_square = 64;
+
+// Every move adds a disc and passes never follow each other before the end, so no game is longer than this
+constexpr int max_game_plies = 128;
+
+// Playouts between time checks
+constexpr std::uint64_t time_check_interval = 64;
+
+// Playouts of the main thread between progress reports
+constexpr std::uint64_t progress_interval = 4096;
+
+// Plies from the previous root searched for the new one, enough for a move and the reply or a pass
+constexpr int max_reuse_plies = 2;
+
+
+enum class Expansion : std::uint8_t {
+    None,
+    // Children are being added by one thread, the others play out from the node meanwhile
+    Busy,
+    Done,
+};
+
+
+struct MctsNode {
+    // Move into the node, pass_square for a pass
+    std::uint8_t square{pass_square};
+    std::atomic<Expansion> expansion{Expansion::None};
+    // None once expanded if the game is over
+    std::uint8_t child_count{0};
+    // Playouts through the node, including the virtual losses of those still running
+    std::atomic<std::uint32_t> visits{0};
+    // Two per won and one per drawn playout, for the side that moved into the node
+    std::atomic<std::uint64_t> score{0};
+    // In the same arena as the node
+    MctsNode *children{nullptr};
+};
+
+// Arenas hand out raw memory and never destroy nodes
+static_assert(std::is_trivially_destructible_v<MctsNode>);
+
+
+// First child with the most visits, node must have children
+const MctsNode &most_visited(const MctsNode &node) {
+    auto best = &node.children[0];
+
+    for (int i = 1; i < node.child_count; i++) {
+        if (node.children[i].visits.load(std::memory_order_relaxed) > best->visits.load(std::memory_order_relaxed)) {
+            best = &node.children[i];
+        }
+    }
+
+    return *best;
+}
+
+
+// Bump allocator for the nodes of one tree. Clearing frees every node at once, and memory is only touched as nodes
+// are handed out.
+class NodeArena {
+public:
+    explicit NodeArena(std::size_t capacity)
+        : _memory{new std::byte[capacity * sizeof(MctsNode)]}, _capacity{capacity} {
+    }
+
+    // Safe to call from several threads, nullptr once the arena is full
+    [[nodiscard]] MctsNode *allocate(std::size_t count) {
+        auto first = _used.fetch_add(count, std::memory_order_relaxed);
+
+        if (first + count > _capacity) {
+            return nullptr;
+        }
+
+        auto nodes = reinterpret_cast<MctsNode *>(_memory.get()) + first;
+
+        for (std::size_t i = 0; i < count; i++) {
+            std::construct_at(nodes + i);
+        }
+
+        return nodes;
+    }
+
+    void clear() {
+        _used = 0;
+    }
+
+    [[nodiscard]] std::size_t used() const {
+        return std::min<std::size_t>(_used, _capacity);
+    }
+
+    [[nodiscard]] std::size_t capacity() const {
+        return _capacity;
+    }
+
+private:
+    std::unique_ptr<std::byte[]> _memory;
+    const std::size_t _capacity;
+    std::atomic<std::size_t> _used{0};
+};
+
+
+// The tree kept by a player between searches. Its nodes live in one of two arenas: moving to a new root copies the
+// subtree still reachable into the other arena and clears the old one in one step.
+class MctsTree {
+public:
+    explicit MctsTree(std::size_t tree_mb)
+        : _arenas{NodeArena{arena_capacity(tree_mb)}, NodeArena{arena_capacity(tree_mb)}} {
+    }
+
+    // Keeps what was searched below the position if it is at most max_reuse_plies from the previous root.
+    // Returns the nodes kept.
+    std::size_t set_root(const Board &board, Piece to_move, bool reuse) {
+        auto &old_arena = _arenas[_active];
+        auto &new_arena = _arenas[1 - _active];
+        auto kept = reuse && _root != nullptr ? find(*_root, _board, _to_move, board, to_move, max_reuse_plies)
+                                              : nullptr;
+
+        new_arena.clear();
+        _root = kept != nullptr ? copy(*kept, new_arena) : nullptr;
+
+        // A nearly full tree could hardly grow, start over instead
+        if (_root == nullptr || new_arena.used() > new_arena.capacity() / 4 * 3) {
+            new_arena.clear();
+            _root = nullptr;
+        }
+
+        auto reused = new_arena.used();
+
+        if (_root == nullptr) {
+            _root = new_arena.allocate(1);
+        }
+
+        old_arena.clear();
+        _active = 1 - _active;
+        _board = board;
+        _to_move = to_move;
+        return reused;
+    }
+
+    [[nodiscard]] MctsNode &root() {
+        return *_root;
+    }
+
+    [[nodiscard]] const Board &board() const {
+        return _board;
+    }
+
+    [[nodiscard]] Piece to_move() const {
+        return _to_move;
+    }
+
+    [[nodiscard]] NodeArena &arena() {
+        return _arenas[_active];
+    }
+
+private:
+    // Always room for a root and its children after keeping three quarters of an arena
+    [[nodiscard]] static std::size_t arena_capacity(std::size_t tree_mb) {
+        return std::max<std::size_t>(tree_mb * 1024 * 1024 / 2 / sizeof(MctsNode), 4 * (1 + 64));
+    }
+
+    [[nodiscard]] static const MctsNode *find(const MctsNode &node, const Board &board, Piece to_move,
+                                              const Board &target, Piece target_to_move, int plies) {
+        if (board == target && to_move == target_to_move) {
+            return &node;
+        }
+
+        if (plies == 0 || node.expansion.load(std::memory_order_acquire) != Expansion::Done) {
+            return nullptr;
+        }
+
+        for (int i = 0; i < node.child_count; i++) {
+            const auto &child = node.children[i];
+            auto child_board = board;
+
+            if (child.square != pass_square) {
+                child_board.make(Move{.piece = to_move, .row = child.square / 8, .column = child.square % 8});
+            }
+
+            if (auto found = find(child, child_board, opponent(to_move), target, target_to_move, plies - 1)) {
+                return found;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // The copy always fits, the other arena held the whole tree
+    [[nodiscard]] static MctsNode *copy(const MctsNode &node, NodeArena &arena) {
+        auto copied = arena.allocate(1);
+        copy_into(node, *copied, arena);
+        return copied;
+    }
+
+    static void copy_into(const MctsNode &node, MctsNode &copied, NodeArena &arena) {
+        copied.square = node.square;
+        copied.visits = node.visits.load(std::memory_order_relaxed);
+        copied.score = node.score.load(std::memory_order_relaxed);
+
+        if (node.expansion.load(std::memory_order_acquire) != Expansion::Done) {
+            return;
+        }
+
+        copied.child_count = node.child_count;
+        copied.children = node.child_count != 0 ? arena.allocate(node.child_count) : nullptr;
+
+        for (int i = 0; i < node.child_count; i++) {
+            copy_into(node.children[i], copied.children[i], arena);
+        }
+
+        copied.expansion.store(Expansion::Done, std::memory_order_relaxed);
+    }
+
+    NodeArena _arenas[2];
+    int _active{0};
+    MctsNode *_root{nullptr};
+    Board _board{};
+    Piece _to_move{Piece::Black};
+};
+
+
+class TreeSearch {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TreeSearch(
+        MctsTree &tree, MctsLimits limits, const MctsOptions &options, Clock::time_point start, std::stop_token stop
+    ) : _tree{tree}, _limits{limits}, _options{options}, _start{start}, _stop_token{std::move(stop)} {
+        expand(tree.root(), tree.board(), tree.to_move());
+    }
+
+    [[nodiscard]] std::uint64_t playouts() const {
+        return _playouts;
+    }
+
+    // Progress is only given to the main thread
+    void run(std::uint64_t seed, const ProgressCallback *progress) {
+        std::mt19937_64 random{seed};
+
+        for (std::uint64_t own = 1; !_stop.load(std::memory_order_relaxed); own++) {
+            playout(random);
+
+            if (_stop_token.stop_requested()) {
+                _stop = true;
+            }
+
+            if (progress != nullptr && *progress && own % progress_interval == 0) {
+                report(*progress);
+            }
+
+            auto count = _playouts.fetch_add(1, std::memory_order_relaxed) + 1;
+
+            if (_limits.playouts != 0 && count >= _limits.playouts) {
+                _stop = true;
+            }
+
+            if (_limits.time.count() != 0 && count % time_check_interval == 0 &&
+                Clock::now() - _start >= _limits.time) {
+                _stop = true;
+            }
+        }
+    }
+
+private:
+    // The most visited line, its length as the depth and the win rate of its first move in percent as the score
+    void report(const ProgressCallback &progress) const {
+        const auto &root = _tree.root();
+        const auto &best = most_visited(root);
+        auto depth = 0;
+
+        for (auto node = &root; node->expansion.load(std::memory_order_acquire) == Expansion::Done &&
+                                node->child_count != 0 && node->visits.load(std::memory_order_relaxed) != 0;
+             node = &most_visited(*node)) {
+            depth++;
+        }
+
+        auto visits = std::max(best.visits.load(std::memory_order_relaxed), 1u);
+        auto piece = _tree.to_move();
+
+        progress(MoveProgress{
+            .move = Move{.piece = piece, .row = best.square / 8, .column = best.square % 8},
+            .depth = depth,
+            .score = static_cast<int>(50 * best.score.load(std::memory_order_relaxed) / visits),
+        });
+    }
+
+    // The tree only grows, so a thread that loses the race leaves the node to the winner. Nodes stay leaves once the
+    // arena is full.
+    void expand(MctsNode &node, const Board &board, Piece to_move) {
+        auto expected = Expansion::None;
+
+        if (!node.expansion.compare_exchange_strong(expected, Expansion::Busy, std::memory_order_acquire)) {
+            return;
+        }
+
+        auto moves = board.legal_moves(to_move);
+        auto count = moves != 0 ? std::popcount(moves) : board.legal_moves(opponent(to_move)) != 0 ? 1 : 0;
+
+        if (count != 0) {
+            node.children = _tree.arena().allocate(count);
+
+            if (node.children == nullptr) {
+                node.expansion.store(Expansion::None, std::memory_order_release);
+                return;
+            }
+
+            // A pass keeps the default square
+            for (auto child = node.children; moves != 0; moves &= moves - 1) {
+                (child++)->square = static_cast<std::uint8_t>(std::countr_zero(moves));
+            }
+
+            node.child_count = static_cast<std::uint8_t>(count);
+        }
+
+        node.expansion.store(Expansion::Done, std::memory_order_release);
+    }
+
+    // Unvisited children first, in move order
+    [[nodiscard]] MctsNode &select_child(MctsNode &node) const {
+        auto log_visits = std::log(static_cast<double>(std::max(node.visits.load(std::memory_order_relaxed), 1u)));
+        auto best = &node.children[0];
+        auto best_value = -std::numeric_limits<double>::infinity();
+
+        for (int i = 0; i < node.child_count; i++) {
+            auto &child = node.children[i];
+            auto visits = child.visits.load(std::memory_order_relaxed);
+
+            if (visits == 0) {
+                return child;
+            }
+
+            auto win_rate = static_cast<double>(child.score.load(std::memory_order_relaxed)) / (2.0 * visits);
+            auto value = win_rate + _options.exploration * std::sqrt(log_visits / visits);
+
+            if (value > best_value) {
+                best_value = value;
+                best = &child;
+            }
+        }
+
+        return *best;
+    }
+
+    void playout(std::mt19937_64 &random) {
+        std::array<MctsNode *, max_game_plies> path;
+        std::array<Piece, max_game_plies> movers;
+        auto length = 0;
+        auto board = _tree.board();
+        auto to_move = _tree.to_move();
+        auto node = &_tree.root();
+
+        path[length] = node;
+        movers[length++] = opponent(to_move);
+        node->visits.fetch_add(_options.virtual_loss, std::memory_order_relaxed);
+
+        // Down through expanded nodes, then expand the first node reached that is not
+        while (node->expansion.load(std::memory_order_acquire) == Expansion::Done && node->child_count != 0) {
+            node = &select_child(*node);
+            node->visits.fetch_add(_options.virtual_loss, std::memory_order_relaxed);
+
+            if (node->square != pass_square) {
+                board.make(Move{.piece = to_move, .row = node->square / 8, .column = node->square % 8});
+            }
+
+            path[length] = node;
+            movers[length++] = to_move;
+            to_move = opponent(to_move);
+
+            if (node->expansion.load(std::memory_order_acquire) != Expansion::Done) {
+                expand(*node, board, to_move);
+                break;
+            }
+        }
+
+        auto black_lead = rollout(board, to_move, random);
+
+        // Adding 1 - virtual_loss visits wraps around to take the virtual losses back
+        for (int i = 0; i < length; i++) {
+            auto lead = movers[i] == Piece::Black ? black_lead : -black_lead;
+            path[i]->score.fetch_add(lead > 0 ? 2 : lead == 0 ? 1 : 0, std::memory_order_relaxed);
+            path[i]->visits.fetch_add(static_cast<std::uint32_t>(1 - _options.virtual_loss), std::memory_order_relaxed);
+        }
+    }
+
+    // Black minus white discs at the end of the game
+    [[nodiscard]] int rollout(const Board &board, Piece to_move, std::mt19937_64 &random) const {
+        auto own = board.discs(to_move);
+        auto enemy = board.discs(opponent(to_move));
+        auto black_to_move = to_move == Piece::Black;
+
+        while (true) {
+            auto moves = legal_move_mask(own, enemy);
+
+            if (moves == 0) {
+                if (legal_move_mask(enemy, own) == 0) {
+                    break;
+                }
+
+                std::swap(own, enemy);
+                black_to_move = !black_to_move;
+                continue;
+            }
+
+            auto move = _options.rollout == RolloutPolicy::Greedy ? greedy_move(own, enemy, moves, random)
+                                                                  : random_move(moves, random);
+            auto flipped = flip_mask(own, enemy, move);
+
+            own |= move | flipped;
+            enemy &= ~flipped;
+            std::swap(own, enemy);
+            black_to_move = !black_to_move;
+        }
+
+        auto lead = std::popcount(own) - std::popcount(enemy);
+        return black_to_move ? lead : -lead;
+    }
+
+    [[nodiscard]] static std::uint64_t random_move(std::uint64_t moves, std::mt19937_64 &random) {
+        for (auto skip = random() % std::popcount(moves); skip > 0; skip--) {
+            moves &= moves - 1;
+        }
+
+        return moves & -moves;
+    }
+
+    [[nodiscard]] static std::uint64_t greedy_move(std::uint64_t own, std::uint64_t enemy, std::uint64_t moves,
+                                                   std::mt19937_64 &random) {
+        std::uint64_t best = 0;
+        auto best_flips = 0;
+        auto ties = 0;
+
+        for (; moves != 0; moves &= moves - 1) {
+            auto move = moves & -moves;
+            auto flips = std::popcount(flip_mask(own, enemy, move));
+
+            if (flips > best_flips) {
+                best = move;
+                best_flips = flips;
+                ties = 1;
+            } else if (flips == best_flips && random() % ++ties == 0) {
+                best = move;
+            }
+        }
+
+        return best;
+    }
+
+    MctsTree &_tree;
+    const MctsLimits _limits;
+    const MctsOptions &_options;
+    const Clock::time_point _start;
+    const std::stop_token _stop_token;
+    std::atomic<bool> _stop{false};
+    std::atomic<std::uint64_t> _playouts{0};
+};
+
+
+double MctsResult::playouts_per_second() const {
+    if (elapsed.count() == 0) {
+        return 0;
+    }
+
+    return static_cast<double>(playouts) / std::chrono::duration<double>(elapsed).count();
+}
+
+
+MctsPlayer::MctsPlayer(Piece piece, MctsLimits limits, MctsOptions options)
+    : _piece{piece}, _limits{limits}, _options{options} {
+    if (limits.playouts == 0 && limits.time.count() == 0) {
+        throw std::invalid_argument("MCTS needs a playout or time limit");
+    }
+
+    _tree = std::make_unique<MctsTree>(options.tree_mb);
+}
+
+MctsPlayer::~MctsPlayer() = default;
+
+Piece MctsPlayer::piece() const {
+    return _piece;
+}
+
+Move MctsPlayer::choose_move(const Game &game, std::stop_token stop, const ProgressCallback &progress) const {
+    _last_result = search(game, std::move(stop), progress);
+    return _last_result.move;
+}
+
+MctsResult MctsPlayer::search(const Game &game, std::stop_token stop, const ProgressCallback &progress) const {
+    auto start = TreeSearch::Clock::now();
+    auto reused = _tree->set_root(game.board(), _piece, _options.reuse_tree);
+    TreeSearch tree{*_tree, _limits, _options, start, std::move(stop)};
+    const auto &root = _tree->root();
+
+    // Nothing to choose between, an invalid move if the only choice is to pass
+    if (root.child_count <= 1) {
+        auto square = root.child_count == 1 ? root.children[0].square : pass_square;
+
+        return MctsResult{
+            .move = square == pass_square ? Move{} : Move{.piece = _piece, .row = square / 8, .column = square % 8},
+            .nodes = _tree->arena().used(),
+            .reused_nodes = reused,
+            .elapsed = TreeSearch::Clock::now() - start,
+        };
+    }
+
+    auto seed = _options.seed ^ (++_searches * 0x9e3779b97f4a7c15);
+    std::vector<std::thread> helpers;
+
+    for (int i = 1; i < _options.threads; i++) {
+        helpers.emplace_back([&, i] {
+            tree.run(seed + i, nullptr);
+        });
+    }
+
+    tree.run(seed, &progress);
+
+    for (auto &helper: helpers) {
+        helper.join();
+    }
+
+    auto best = &most_visited(root);
+
+    return MctsResult{
+        .move = Move{.piece = _piece, .row = best->square / 8, .column = best->square % 8},
+        .win_rate = best->visits == 0 ? 0 : static_cast<double>(best->score) / (2.0 * best->visits),
+        .playouts = tree.playouts(),
+        .nodes = _tree->arena().used(),
+        .reused_nodes = reused,
+        .elapsed = TreeSearch::Clock::now() - start,
+    };
+}
+
+const MctsResult &MctsPlayer::last_result() const {
+    return _last_result;
+}
@@ -0,0 +1,100 @@
+#ifndef REVERSI_MCTS_H
+#define REVERSI_MCTS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "reversi.h"
+
+
+enum class RolloutPolicy {
+    // Uniformly random legal moves
+    Random,
+    // The move flipping the most discs like CpuPlayer, ties broken at random so playouts still differ
+    Greedy,
+};
+
+
+struct MctsLimits {
+    // Stop after this many playouts over all threads, 0 for no limit
+    std::uint64_t playouts{10000};
+    // Wall-clock budget per move, 0 for no limit
+    std::chrono::milliseconds time{0};
+};
+
+
+struct MctsOptions {
+    // Threads growing the same tree
+    int threads{1};
+    RolloutPolicy rollout{RolloutPolicy::Random};
+    // UCT exploration constant
+    double exploration{1.4};
+    // Lost playouts a thread adds to every node on its way down until its playout finishes, so other threads
+    // explore elsewhere
+    int virtual_loss{3};
+    std::uint64_t seed{1};
+    // Memory for the tree, half of it used at a time
+    std::size_t tree_mb{32};
+    // Keep the part of the tree below the position reached since the last search
+    bool reuse_tree{true};
+};
+
+
+struct MctsResult {
+    Move move{};
+    // Of the move played, from the searching side, draws count as half a win
+    double win_rate{0};
+    // Summed over all threads
+    std::uint64_t playouts{0};
+    // Tree nodes, expanded or not, after the search
+    std::uint64_t nodes{0};
+    // Nodes kept from the previous search
+    std::uint64_t reused_nodes{0};
+    std::chrono::nanoseconds elapsed{0};
+
+    [[nodiscard]] double playouts_per_second() const;
+};
+
+
+class MctsTree;
+
+
+// Monte Carlo tree search: the tree grows one node per playout, choosing children by UCT, and every new node is
+// scored by playing the game out with the rollout policy. The move played is the most visited one. The tree is kept
+// between moves, so the next search starts from what was already searched below the position.
+class MctsPlayer : public Player {
+public:
+    // Throws std::invalid_argument if neither the playouts nor the time are limited
+    explicit MctsPlayer(Piece piece, MctsLimits limits = {}, MctsOptions options = {});
+
+    ~MctsPlayer() override;
+
+    [[nodiscard]] Piece piece() const override;
+
+    // A stop request ends the search after the running playouts. Progress gives the most visited line every few
+    // thousand playouts, its length as the depth and the win rate of its first move in percent as the score.
+    [[nodiscard]] MctsResult search(
+        const Game &game, std::stop_token stop = {}, const ProgressCallback &progress = {}
+    ) const;
+
+    // Result of the search behind the last move chosen
+    [[nodiscard]] const MctsResult &last_result() const;
+
+protected:
+    [[nodiscard]] Move choose_move(
+        const Game &game, std::stop_token stop, const ProgressCallback &progress
+    ) const override;
+
+private:
+    const Piece _piece{Piece::Black};
+    const MctsLimits _limits{};
+    const MctsOptions _options{};
+    // Searches so far, so each one plays different playouts
+    mutable std::uint64_t _searches{0};
+    std::unique_ptr<MctsTree> _tree{};
+    mutable MctsResult _last_result{};
+};
+
+#endif //REVERSI_MCTS_H
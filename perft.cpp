@@ -0,0 +1,147 @@
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "reversi.h"
+
+// Counts move paths of a given length from the standard start. By default a pass is not a move, the turn goes back
+// to the other side as in Game::next_move returning MoveStatus::ContinueWithSkip. With --pass-as-move a pass takes
+// a ply of its own, which is the convention of the published Othello perft tables. A game that ends early counts
+// as one leaf in both conventions.
+
+// Published counts with a pass as a move, depths 1 to 14
+constexpr std::uint64_t published_pass_as_move[] = {
+    4, 12, 56, 244, 1396, 8200, 55092, 390216, 3005288, 24571284, 212258800, 1939886636, 18429641748,
+    184042084512,
+};
+
+// Counts with passes implied. The first 8 match the published table, passes and early game ends only start at
+// depth 9 where these were cross-checked against a plain make/unmake enumeration.
+constexpr std::uint64_t reference_implied_pass[] = {
+    4, 12, 56, 244, 1396, 8200, 55092, 390216, 3005320, 24571420, 212260880,
+};
+
+struct Options {
+    int depth{9};
+    bool pass_as_move{false};
+};
+
+std::uint64_t perft_implied_pass(Board &board, Piece piece, int depth) {
+    auto moves = board.legal_moves(piece);
+
+    if (moves == 0) {
+        piece = opponent(piece);
+        moves = board.legal_moves(piece);
+
+        if (moves == 0) {
+            return 1;
+        }
+    }
+
+    // The last ply is counted from the move mask without being played
+    if (depth == 1) {
+        return std::popcount(moves);
+    }
+
+    std::uint64_t leaves = 0;
+
+    for (; moves != 0; moves &= moves - 1) {
+        auto square = std::countr_zero(moves);
+        auto undo = board.make(Move{.piece = piece, .row = square / 8, .column = square % 8});
+        leaves += perft_implied_pass(board, opponent(piece), depth - 1);
+        board.unmake(undo);
+    }
+
+    return leaves;
+}
+
+std::uint64_t perft_pass_as_move(Board &board, Piece piece, int depth, bool passed) {
+    auto moves = board.legal_moves(piece);
+
+    if (moves == 0) {
+        if (passed || depth == 1) {
+            return 1;
+        }
+
+        return perft_pass_as_move(board, opponent(piece), depth - 1, true);
+    }
+
+    if (depth == 1) {
+        return std::popcount(moves);
+    }
+
+    std::uint64_t leaves = 0;
+
+    for (; moves != 0; moves &= moves - 1) {
+        auto square = std::countr_zero(moves);
+        auto undo = board.make(Move{.piece = piece, .row = square / 8, .column = square % 8});
+        leaves += perft_pass_as_move(board, opponent(piece), depth - 1, false);
+        board.unmake(undo);
+    }
+
+    return leaves;
+}
+
+bool parse_options(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; i++) {
+        auto option = std::string{argv[i]};
+
+        if (option == "--pass-as-move") {
+            options.pass_as_move = true;
+        } else if (option == "--depth" && i + 1 < argc) {
+            try {
+                options.depth = std::stoi(argv[++i]);
+            } catch (const std::exception &) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    return options.depth >= 1;
+}
+
+int main(int argc, char *argv[]) {
+    auto options = Options{};
+
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--depth <plies>] [--pass-as-move]" << std::endl;
+        return 1;
+    }
+
+    const auto *expected = options.pass_as_move ? published_pass_as_move : reference_implied_pass;
+    auto expected_depths = options.pass_as_move ? std::size(published_pass_as_move) : std::size(reference_implied_pass);
+    auto mismatches = 0;
+
+    std::printf("%5s %16s %12s %14s  %s\n", "depth", "leaves", "time", "leaves/s", "check");
+
+    for (int depth = 1; depth <= options.depth; depth++) {
+        Board board;
+        auto start = std::chrono::steady_clock::now();
+        auto leaves = options.pass_as_move ? perft_pass_as_move(board, Piece::Black, depth, false)
+                                           : perft_implied_pass(board, Piece::Black, depth);
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const char *check = "-";
+
+        if (static_cast<std::size_t>(depth) <= expected_depths) {
+            check = leaves == expected[depth - 1] ? "ok" : "MISMATCH";
+            mismatches += leaves != expected[depth - 1];
+        }
+
+        std::printf(
+            "%5d %16llu %10.3f s %14.0f  %s\n",
+            depth,
+            static_cast<unsigned long long>(leaves),
+            seconds,
+            seconds > 0 ? static_cast<double>(leaves) / seconds : 0.0,
+            check
+        );
+        std::fflush(stdout);
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
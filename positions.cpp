@@ -0,0 +1,76 @@
+#include "positions.h"
+
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+// Records are copied as they are in memory
+static_assert(std::endian::native == std::endian::little);
+
+constexpr char position_magic[8] = {'R', 'V', 'P', 'O', 'S', 0, 0, 1};
+
+constexpr std::size_t record_size = 17;
+
+
+PositionWriter::PositionWriter(const std::string &path) : _file{path, std::ios::binary | std::ios::trunc} {
+    if (!_file) {
+        throw std::runtime_error("can't create " + path);
+    }
+
+    _file.write(position_magic, sizeof(position_magic));
+}
+
+void PositionWriter::write(const LabelledPosition &position) {
+    char record[record_size];
+
+    std::memcpy(record, &position.black, 8);
+    std::memcpy(record + 8, &position.white, 8);
+    std::memcpy(record + 16, &position.score, 1);
+
+    _file.write(record, record_size);
+}
+
+void PositionWriter::write(const Board &board, int black_score) {
+    write(LabelledPosition{
+        .black = board.discs(Piece::Black),
+        .white = board.discs(Piece::White),
+        .score = static_cast<std::int8_t>(black_score),
+    });
+}
+
+bool PositionWriter::good() const {
+    return _file.good();
+}
+
+
+PositionReader::PositionReader(const std::string &path) : _file{path, std::ios::binary} {
+    char magic[sizeof(position_magic)];
+
+    if (!_file.read(magic, sizeof(magic)) || std::memcmp(magic, position_magic, sizeof(magic)) != 0) {
+        throw std::runtime_error(path + " is not a position file");
+    }
+}
+
+std::size_t PositionReader::read(std::vector<LabelledPosition> &batch, std::size_t count) {
+    _buffer.resize(count * record_size);
+    _file.read(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+
+    // A truncated last record is dropped
+    auto read = static_cast<std::size_t>(_file.gcount()) / record_size;
+    batch.resize(read);
+
+    for (std::size_t i = 0; i < read; i++) {
+        const auto *record = _buffer.data() + i * record_size;
+
+        std::memcpy(&batch[i].black, record, 8);
+        std::memcpy(&batch[i].white, record + 8, 8);
+        std::memcpy(&batch[i].score, record + 16, 1);
+    }
+
+    return read;
+}
+
+void PositionReader::rewind() {
+    _file.clear();
+    _file.seekg(sizeof(position_magic));
+}
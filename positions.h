@@ -0,0 +1,58 @@
+#ifndef REVERSI_POSITIONS_H
+#define REVERSI_POSITIONS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "reversi.h"
+
+// Training data: positions labelled with the final result of the game they come from. A file is an 8-byte header
+// followed by 17-byte records, black and white bitboards then the final disc difference, little-endian.
+
+
+struct LabelledPosition {
+    std::uint64_t black{0};
+    std::uint64_t white{0};
+    // Final disc difference from black's side, the empty cells counted for the winner as in GameRecordHeader
+    std::int8_t score{0};
+};
+
+
+class PositionWriter {
+public:
+    // Throws std::runtime_error if the file can't be created
+    explicit PositionWriter(const std::string &path);
+
+    void write(const LabelledPosition &position);
+
+    void write(const Board &board, int black_score);
+
+    // False once any write failed
+    [[nodiscard]] bool good() const;
+
+private:
+    std::ofstream _file;
+};
+
+
+// Reads a file sequentially through a fixed buffer, so files of any size stream in constant memory
+class PositionReader {
+public:
+    // Throws std::runtime_error if the file can't be opened or has no position header
+    explicit PositionReader(const std::string &path);
+
+    // Replaces batch with up to count positions, returns how many were read, 0 at the end of the file
+    std::size_t read(std::vector<LabelledPosition> &batch, std::size_t count);
+
+    // Back to the first position
+    void rewind();
+
+private:
+    std::ifstream _file;
+    std::vector<char> _buffer{};
+};
+
+#endif //REVERSI_POSITIONS_H
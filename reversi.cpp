@@ -1,109 +1,161 @@
 #include "reversi.h"
 
+#include <bit>
 #include <iostream>
+#include <memory>
 
-struct RelativePosition {
-    int row_diff;
-    int col_diff;
+#include "bitboard.h"
+#include "thread_pool.h"
+
+constexpr std::uint64_t splitmix64(std::uint64_t &state) {
+    state += 0x9e3779b97f4a7c15;
+    auto z = state;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+struct ZobristKeys {
+    std::uint64_t black[64]{};
+    std::uint64_t white[64]{};
+    // black ^ white, toggles a square between the two colors
+    std::uint64_t flip[64]{};
+    std::uint64_t white_to_move{0};
 };
 
+constexpr ZobristKeys make_zobrist_keys() {
+    ZobristKeys keys;
+    std::uint64_t state = 0x5265766572736921;
 
-int calculate_valid_moves(const Board &board, Piece current_turn) {
-    int valid_move_count = 0;
+    for (int square = 0; square < 64; square++) {
+        keys.black[square] = splitmix64(state);
+        keys.white[square] = splitmix64(state);
+        keys.flip[square] = keys.black[square] ^ keys.white[square];
+    }
 
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (board.get(i, j) == Cell::Empty) {
-                Board copy_board = board;
+    keys.white_to_move = splitmix64(state);
+    return keys;
+}
 
-                if (copy_board.put(current_turn, i, j) == Result::Ok) {
-                    valid_move_count++;
-                }
-            }
-        }
+constexpr ZobristKeys zobrist = make_zobrist_keys();
+
+std::uint64_t zobrist_hash(std::uint64_t black, std::uint64_t white) {
+    std::uint64_t hash = 0;
+
+    for (; black != 0; black &= black - 1) {
+        hash ^= zobrist.black[std::countr_zero(black)];
     }
 
-    return valid_move_count;
+    for (; white != 0; white &= white - 1) {
+        hash ^= zobrist.white[std::countr_zero(white)];
+    }
+
+    return hash;
 }
 
+std::uint64_t zobrist_flip_hash(std::uint64_t flipped) {
+    std::uint64_t hash = 0;
 
-std::vector<RelativePosition>
-get_enemy_positions(const std::vector<std::vector<Cell>> &cells, Cell put_cell, int row, int column) {
-    std::vector<RelativePosition> enemy_positions{};
+    for (; flipped != 0; flipped &= flipped - 1) {
+        hash ^= zobrist.flip[std::countr_zero(flipped)];
+    }
 
-    for (int i = -1; i <= 1; i++) {
-        for (int j = -1; j <= 1; j++) {
-            if ((row + i < 0) || (row + i >= 8) || (column + j < 0) || (column + j >= 8)) {
-                continue;
-            }
+    return hash;
+}
 
-            if ((i == 0) && (j == 0)) {
-                continue;
-            }
 
-            if ((cells[row + i][column + j] != Cell::Empty) && (cells[row + i][column + j] != put_cell)) {
-                enemy_positions.push_back(RelativePosition{.row_diff = i, .col_diff = j});
-            }
-        }
+std::uint64_t square_mask(int row, int column) {
+    return std::uint64_t{1} << (row * 8 + column);
+}
+
+std::uint64_t placed_key(Move move) {
+    auto square = move.row * 8 + move.column;
+    return move.piece == Piece::Black ? zobrist.black[square] : zobrist.white[square];
+}
+
+
+std::uint64_t transform_bits(std::uint64_t bits, Symmetry symmetry) {
+    auto operations = static_cast<int>(symmetry);
+
+    if (operations & 1) {
+        bits = transpose(bits);
+    }
+
+    if (operations & 2) {
+        bits = flip_vertical(bits);
     }
 
-    return enemy_positions;
+    if (operations & 4) {
+        bits = mirror_horizontal(bits);
+    }
+
+    return bits;
 }
 
-int flip_cells(
-    std::vector<std::vector<Cell>> &cells,
-    const std::vector<RelativePosition> &enemy_positions,
-    Cell put_cell,
-    int row,
-    int column
-) {
-    int flipped_cell_count = 0;
 
-    for (auto &position: enemy_positions) {
-        int i = 1;
-        while (true) {
-            if ((row + (i * position.row_diff) < 0) || (row + (i * position.row_diff) >= 8) ||
-                (column + (i * position.col_diff) < 0) || (column + (i * position.col_diff) >= 8)) {
-                break;
-            }
+Piece opponent(Piece piece) {
+    return piece == Piece::Black ? Piece::White : Piece::Black;
+}
 
-            if (cells[row + (i * position.row_diff)][column + (i * position.col_diff)] == Cell::Empty) {
-                break;
-            }
 
-            if (cells[row + (i * position.row_diff)][column + (i * position.col_diff)] == put_cell) {
-                for (int j = 1; j < i; j++) {
-                    cells[row + (j * position.row_diff)][column + (j * position.col_diff)] = put_cell;
-                    flipped_cell_count++;
-                }
-                break;
-            }
+Symmetry inverse(Symmetry symmetry) {
+    auto operations = static_cast<int>(symmetry);
 
-            i++;
-        }
+    // Undoing flips then transposes, which is transposing first with the row flip and column mirror swapped
+    if (operations & 1) {
+        operations = 1 | (operations & 2) << 1 | (operations & 4) >> 1;
     }
 
-    return flipped_cell_count;
+    return static_cast<Symmetry>(operations);
+}
+
+Move transform(Move move, Symmetry symmetry) {
+    auto square = std::countr_zero(transform_bits(square_mask(move.row, move.column), symmetry));
+    return Move{.piece = move.piece, .row = square / 8, .column = square % 8};
+}
+
+
+int calculate_valid_moves(const Board &board, Piece current_turn) {
+    return std::popcount(board.legal_moves(current_turn));
 }
 
 
 Board::Board() {
-    _cells[3][3] = Cell::White;
-    _cells[3][4] = Cell::Black;
-    _cells[4][3] = Cell::Black;
-    _cells[4][4] = Cell::White;
+    _white = square_mask(3, 3) | square_mask(4, 4);
+    _black = square_mask(3, 4) | square_mask(4, 3);
+    _hash = zobrist_hash(_black, _white);
 }
 
-Board::Board(std::vector<std::vector<Cell>> cells) : _cells{std::move(cells)} {
-    if (_cells.size() != 8) {
+Board::Board(std::vector<std::vector<Cell>> cells) {
+    if (cells.size() != 8) {
         throw std::invalid_argument("cells should have 8 rows");
     }
 
-    for (auto &row: _cells) {
+    for (auto &row: cells) {
         if (row.size() != 8) {
             throw std::invalid_argument("cells should have 8 columns");
         }
     }
+
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++) {
+            if (cells[i][j] == Cell::Black) {
+                _black |= square_mask(i, j);
+            } else if (cells[i][j] == Cell::White) {
+                _white |= square_mask(i, j);
+            }
+        }
+    }
+
+    _hash = zobrist_hash(_black, _white);
+}
+
+Board::Board(std::uint64_t black, std::uint64_t white) : _black{black}, _white{white} {
+    if ((black & white) != 0) {
+        throw std::invalid_argument("a cell can't hold both colors");
+    }
+
+    _hash = zobrist_hash(_black, _white);
 }
 
 Cell Board::get(int row, int column) const {
@@ -115,71 +167,128 @@ Cell Board::get(int row, int column) const {
         throw std::out_of_range("column should be between 0 and 7");
     }
 
-    return _cells[row][column];
+    auto mask = square_mask(row, column);
+
+    if ((_black & mask) != 0) {
+        return Cell::Black;
+    }
+
+    if ((_white & mask) != 0) {
+        return Cell::White;
+    }
+
+    return Cell::Empty;
+}
+
+std::uint64_t Board::discs(Piece piece) const {
+    return piece == Piece::Black ? _black : _white;
 }
 
 Result Board::put(Piece piece, int row, int column) {
-    if (row < 0 || row >= 8) {
+    if (make(Move{.piece = piece, .row = row, .column = column}).flipped == 0) {
         return Result::Error;
     }
 
-    if (column < 0 || column >= 8) {
-        return Result::Error;
+    return Result::Ok;
+}
+
+UndoInfo Board::make(Move move) {
+    if (move.row < 0 || move.row >= 8) {
+        return UndoInfo{.move = move};
     }
 
-    if (_cells[row][column] != Cell::Empty) {
-        return Result::Error;
+    if (move.column < 0 || move.column >= 8) {
+        return UndoInfo{.move = move};
     }
 
-    auto put_cell = Cell::Empty;
+    auto placed = square_mask(move.row, move.column);
 
-    if (piece == Piece::White) {
-        put_cell = Cell::White;
-    } else if (piece == Piece::Black) {
-        put_cell = Cell::Black;
+    if (((_black | _white) & placed) != 0) {
+        return UndoInfo{.move = move};
     }
 
-    std::vector<RelativePosition> enemy_positions = get_enemy_positions(_cells, put_cell, row, column);
+    auto &own = move.piece == Piece::Black ? _black : _white;
+    auto &enemy = move.piece == Piece::Black ? _white : _black;
 
-    if (enemy_positions.empty()) {
-        return Result::Error;
+    auto flipped = flip_mask(own, enemy, placed);
+
+    if (flipped != 0) {
+        own |= flipped | placed;
+        enemy &= ~flipped;
+        _hash ^= zobrist_flip_hash(flipped) ^ placed_key(move);
     }
 
-    auto flipped_cell_count = flip_cells(_cells, enemy_positions, put_cell, row, column);
+    return UndoInfo{.move = move, .flipped = flipped};
+}
 
-    if (flipped_cell_count == 0) {
-        return Result::Error;
+void Board::unmake(const UndoInfo &undo) {
+    if (undo.flipped == 0) {
+        return;
     }
 
-    _cells[row][column] = put_cell;
+    auto &own = undo.move.piece == Piece::Black ? _black : _white;
+    auto &enemy = undo.move.piece == Piece::Black ? _white : _black;
 
-    return Result::Ok;
+    own &= ~(undo.flipped | square_mask(undo.move.row, undo.move.column));
+    enemy |= undo.flipped;
+    _hash ^= zobrist_flip_hash(undo.flipped) ^ placed_key(undo.move);
 }
 
-int Board::score(Piece piece) const {
-    int score = 0;
-
-    Cell cell_to_count = Cell::Empty;
+std::uint64_t Board::hash() const {
+    return _hash;
+}
 
-    if (piece == Piece::White) {
-        cell_to_count = Cell::White;
-    } else if (piece == Piece::Black) {
-        cell_to_count = Cell::Black;
+std::uint64_t Board::legal_moves(Piece piece) const {
+    if (piece == Piece::Black) {
+        return legal_move_mask(_black, _white);
     }
 
-    for (auto &row: _cells) {
-        for (auto &cell: row) {
-            if (cell == cell_to_count) {
-                score++;
-            }
+    return legal_move_mask(_white, _black);
+}
+
+Board Board::transformed(Symmetry symmetry) const {
+    return Board{transform_bits(_black, symmetry), transform_bits(_white, symmetry)};
+}
+
+CanonicalBoard Board::canonical() const {
+    auto black = _black;
+    auto white = _white;
+    auto best = Symmetry::Identity;
+
+    for (int i = 1; i < symmetry_count; i++) {
+        auto symmetry = static_cast<Symmetry>(i);
+        auto symmetric_black = transform_bits(_black, symmetry);
+
+        if (symmetric_black > black) {
+            continue;
+        }
+
+        auto symmetric_white = transform_bits(_white, symmetry);
+
+        if (symmetric_black < black || symmetric_white < white) {
+            black = symmetric_black;
+            white = symmetric_white;
+            best = symmetry;
         }
     }
 
-    return score;
+    if (best == Symmetry::Identity) {
+        return CanonicalBoard{.board = *this};
+    }
+
+    return CanonicalBoard{.board = Board{black, white}, .symmetry = best};
 }
 
-bool Board::operator==(const Board &other) {
-    return _cells == other._cells;
+int Board::score(Piece piece) const {
+    return std::popcount(piece == Piece::Black ? _black : _white);
+}
+
+bool Board::operator==(const Board &other) const {
+    return _black == other._black && _white == other._white;
+}
+
+std::uint64_t position_hash(const Board &board, Piece to_move) {
+    return to_move == Piece::White ? board.hash() ^ zobrist.white_to_move : board.hash();
 }
 
 Game::Game() : _board{Board{}} {}
@@ -202,6 +311,10 @@ int Game::move_count() const {
     return _move_count;
 }
 
+std::uint64_t Game::hash() const {
+    return position_hash(_board, _current_turn);
+}
+
 MoveStatus Game::next_move(Piece piece, int row, int column) {
     if (_current_turn != piece) {
         return MoveStatus::Error;
@@ -241,34 +354,76 @@ MoveStatus Game::next_move(Piece piece, int row, int column) {
     return move_status;
 }
 
+bool play_moves(Game &game, std::string_view moves) {
+    if (moves.size() % 2 != 0) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < moves.size(); i += 2) {
+        auto column = (moves[i] | 0x20) - 'a';
+        auto row = moves[i + 1] - '1';
+
+        if (column < 0 || column >= 8 || row < 0 || row >= 8) {
+            return false;
+        }
+
+        if (game.next_move(game.current_turn(), row, column) == MoveStatus::Error) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Move Player::get_next_move(const Game &game) const {
+    return choose_move(game, {}, {});
+}
+
+std::future<Move> Player::get_next_move_async(const Game &game, std::stop_token stop, ProgressCallback progress) const {
+    return std::async(std::launch::async, [this, game, stop = std::move(stop), progress = std::move(progress)] {
+        return choose_move(game, stop, progress);
+    });
+}
+
+std::future<Move> Player::get_next_move_async(
+    const Game &game, ThreadPool &pool, std::stop_token stop, ProgressCallback progress
+) const {
+    // Pool tasks must be copyable, so the promise is shared with the task
+    auto promise = std::make_shared<std::promise<Move>>();
+    auto move = promise->get_future();
+
+    pool.submit([this, game, promise, stop = std::move(stop), progress = std::move(progress)] {
+        try {
+            promise->set_value(choose_move(game, stop, progress));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+
+    return move;
+}
+
+
 CpuPlayer::CpuPlayer(Piece piece) : _piece{piece} {}
 
 Piece CpuPlayer::piece() const {
     return _piece;
 }
 
-Move CpuPlayer::get_next_move(const Game &game) const {
+Move CpuPlayer::choose_move(const Game &game, std::stop_token, const ProgressCallback &) const {
     auto highestScore = 0;
     auto next_move = Move{};
+    auto board = game.board();
 
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (game.board().get(i, j) != Cell::Empty) {
-                continue;
-            }
-
-            Board copy_board = game.board();
+    for (auto moves = board.legal_moves(_piece); moves != 0; moves &= moves - 1) {
+        auto square = std::countr_zero(moves);
+        auto undo = board.make(Move{.piece = _piece, .row = square / 8, .column = square % 8});
+        auto score = board.score(_piece);
+        board.unmake(undo);
 
-            if (copy_board.put(_piece, i, j) != Result::Ok) {
-                continue;
-            }
-
-            auto score = copy_board.score(_piece);
-
-            if (score > highestScore) {
-                highestScore = score;
-                next_move = Move{.piece = _piece, .row = i, .column = j};
-            }
+        if (score > highestScore) {
+            highestScore = score;
+            next_move = undo.move;
         }
     }
 
@@ -282,14 +437,14 @@ Piece HumanPlayer::piece() const {
     return _piece;
 }
 
-Move HumanPlayer::get_next_move(const Game &game) const {
-    auto row{0};
-    auto column{0};
-
-    while (true) {
+Move HumanPlayer::choose_move(const Game &game, std::stop_token stop, const ProgressCallback &) const {
+    while (!stop.stop_requested()) {
         std::cout << "Enter move (e.g. A5): ";
         std::string input;
-        std::cin >> input;
+
+        if (!(std::cin >> input)) {
+            break;
+        }
 
         if (input.length() != 2) {
             std::cout << "Invalid move " << input << std::endl;
@@ -306,18 +461,16 @@ Move HumanPlayer::get_next_move(const Game &game) const {
             continue;
         }
 
-        row = input[1] - '1';
-        column = input[0] - 'A';
-
-        auto copy_board = game.board();
+        auto row = input[1] - '1';
+        auto column = input[0] - 'A';
 
-        if (copy_board.put(_piece, row, column) != Result::Ok) {
+        if ((game.board().legal_moves(_piece) & square_mask(row, column)) == 0) {
             std::cout << "Invalid move " << input << std::endl;
             continue;
         }
 
-        break;
+        return Move{.piece = _piece, .row = row, .column = column};
     }
 
-    return Move{.piece = _piece, .row = row, .column = column};
+    return Move{};
 }
\ No newline at end of file
@@ -1,7 +1,12 @@
 #ifndef REVERSI_REVERSI_H
 #define REVERSI_REVERSI_H
 
+#include <cstdint>
 #include <exception>
+#include <functional>
+#include <future>
+#include <stop_token>
+#include <string_view>
 #include <vector>
 
 
@@ -18,6 +23,9 @@ enum class Piece {
 };
 
 
+[[nodiscard]] Piece opponent(Piece piece);
+
+
 enum class Result {
     Error,
     Ok,
@@ -37,6 +45,36 @@ struct Move {
 };
 
 
+// What Board::make changed, enough for Board::unmake to restore the board
+struct UndoInfo {
+    Move move{};
+    std::uint64_t flipped{0};
+};
+
+
+// The 8 symmetries of the board. Bits 0, 1 and 2 say whether the symmetry transposes, flips the rows and mirrors the
+// columns, applied in that order.
+enum class Symmetry : std::uint8_t {
+    Identity,
+    Transpose,
+    FlipVertical,
+    RotateLeft,
+    MirrorHorizontal,
+    RotateRight,
+    Rotate180,
+    AntiTranspose,
+};
+
+constexpr int symmetry_count = 8;
+
+
+// Undoes symmetry
+[[nodiscard]] Symmetry inverse(Symmetry symmetry);
+
+// The same move on the board transformed by symmetry
+[[nodiscard]] Move transform(Move move, Symmetry symmetry);
+
+
 enum class MoveStatus {
     Error,
     Continue,
@@ -45,25 +83,68 @@ enum class MoveStatus {
 };
 
 
+struct CanonicalBoard;
+
+
 class Board {
 public:
     Board();
 
     explicit Board(std::vector<std::vector<Cell>> cells);
 
+    // Bit (row * 8 + column) set for every disc, throws std::invalid_argument if a cell has both colors
+    Board(std::uint64_t black, std::uint64_t white);
+
     [[nodiscard]] int score(Piece piece) const;
 
     [[nodiscard]] Cell get(int row, int column) const;
 
+    // Bit (row * 8 + column) is set for every disc of piece
+    [[nodiscard]] std::uint64_t discs(Piece piece) const;
+
     Result put(Piece piece, int row, int column);
 
-    bool operator==(const Board &other);
+    // Same rules as put. If the move is not legal the board is unchanged and the returned flipped mask is 0
+    UndoInfo make(Move move);
+
+    void unmake(const UndoInfo &undo);
+
+    // Zobrist key of the discs on the board, kept up to date by put, make and unmake
+    [[nodiscard]] std::uint64_t hash() const;
+
+    // Bit (row * 8 + column) is set for every cell where piece can be put
+    [[nodiscard]] std::uint64_t legal_moves(Piece piece) const;
+
+    [[nodiscard]] Board transformed(Symmetry symmetry) const;
+
+    // Same for all 8 symmetric versions of a board, so each position can be stored once
+    [[nodiscard]] CanonicalBoard canonical() const;
+
+    bool operator==(const Board &other) const;
 
 private:
-    std::vector<std::vector<Cell>> _cells = std::vector<std::vector<Cell>>(8, std::vector<Cell>(8, Cell::Empty));
+    // One bit per cell, bit index is row * 8 + column
+    std::uint64_t _black{0};
+    std::uint64_t _white{0};
+    std::uint64_t _hash{0};
+};
+
+
+// The symmetric version of a board with the smallest black discs, then white discs, as unsigned masks
+struct CanonicalBoard {
+    Board board{};
+    // Takes the original board to board
+    Symmetry symmetry{Symmetry::Identity};
 };
 
 
+[[nodiscard]] int calculate_valid_moves(const Board &board, Piece current_turn);
+
+
+// Board hash with the side to move folded in, the same key Game::hash gives for that position
+[[nodiscard]] std::uint64_t position_hash(const Board &board, Piece to_move);
+
+
 class Game {
 public:
     Game();
@@ -78,6 +159,9 @@ public:
 
     [[nodiscard]] int move_count() const;
 
+    // Board hash with the side to move folded in
+    [[nodiscard]] std::uint64_t hash() const;
+
     MoveStatus next_move(Piece piece, int row, int column);
 
 private:
@@ -88,34 +172,84 @@ private:
 };
 
 
+// Plays moves written as column letter and row number without separators, e.g. "f5d6c3". Passes are implied, as
+// in Game::next_move. Stops and returns false at the first malformed or illegal move.
+bool play_moves(Game &game, std::string_view moves);
+
+
+// Where a player's choice stands while it is still thinking
+struct MoveProgress {
+    // Best move so far
+    Move move{};
+    // How far the player looked, in plies
+    int depth{0};
+    // From the player's side, in the player's own units
+    int score{0};
+};
+
+
+// Called on the thread choosing the move
+using ProgressCallback = std::function<void(const MoveProgress &)>;
+
+
+class ThreadPool;
+
+
 class Player {
 public:
     virtual ~Player() = default;
 
     [[nodiscard]] virtual Piece piece() const = 0;
 
-    [[nodiscard]] virtual Move get_next_move(const Game &game) const = 0;
+    // Blocks until the move is chosen
+    [[nodiscard]] Move get_next_move(const Game &game) const;
+
+    // Chooses the move on another thread and returns at once. A stop request makes the player answer as soon as it
+    // can with the best move so far. The game is copied, but the player must not be used otherwise until the move is
+    // ready.
+    [[nodiscard]] std::future<Move> get_next_move_async(
+        const Game &game, std::stop_token stop = {}, ProgressCallback progress = {}
+    ) const;
+
+    // Same, queued on pool so many games can share a few threads. The pool must outlive the move.
+    [[nodiscard]] std::future<Move> get_next_move_async(
+        const Game &game, ThreadPool &pool, std::stop_token stop = {}, ProgressCallback progress = {}
+    ) const;
+
+protected:
+    [[nodiscard]] virtual Move choose_move(
+        const Game &game, std::stop_token stop, const ProgressCallback &progress
+    ) const = 0;
 };
 
+// Plays the move flipping the most discs, at once
 class CpuPlayer : public Player {
 public:
     explicit CpuPlayer(Piece piece);
 
     [[nodiscard]] Piece piece() const override;
 
-    [[nodiscard]] Move get_next_move(const Game &game) const override;
+protected:
+    [[nodiscard]] Move choose_move(
+        const Game &game, std::stop_token stop, const ProgressCallback &progress
+    ) const override;
 
 private:
     const Piece _piece{Piece::Black};
 };
 
+// Reads moves from standard input. A stop request is only seen between two inputs and gives an invalid move, as does
+// the end of the input.
 class HumanPlayer : public Player {
 public:
     explicit HumanPlayer(Piece piece);
 
     [[nodiscard]] Piece piece() const override;
 
-    [[nodiscard]] Move get_next_move(const Game &game) const override;
+protected:
+    [[nodiscard]] Move choose_move(
+        const Game &game, std::stop_token stop, const ProgressCallback &progress
+    ) const override;
 
 private:
     const Piece _piece{Piece::Black};
@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark_positions.h"
+#include "reversi.h"
+#include "search.h"
+
+// Time-to-depth and nodes per second of the Lazy SMP search over the benchmark positions, for 1, 2, 4, ... threads
+
+struct Options {
+    int depth{12};
+    int max_threads{64};
+    std::size_t hash_mb{64};
+};
+
+bool parse_options(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; i++) {
+        auto option = std::string{argv[i]};
+
+        if (i + 1 >= argc) {
+            return false;
+        }
+
+        try {
+            if (option == "--depth") {
+                options.depth = std::stoi(argv[++i]);
+            } else if (option == "--max-threads") {
+                options.max_threads = std::stoi(argv[++i]);
+            } else if (option == "--hash-mb") {
+                options.hash_mb = std::stoul(argv[++i]);
+            } else {
+                return false;
+            }
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    auto options = Options{};
+
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--depth <plies>] [--max-threads <threads>] [--hash-mb <megabytes>]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::vector<Game> games;
+
+    for (auto moves: benchmark_positions) {
+        Game game;
+
+        if (!play_moves(game, moves)) {
+            std::cerr << "Invalid benchmark position " << moves << std::endl;
+            return 1;
+        }
+
+        games.push_back(game);
+    }
+
+    std::printf("%d positions, depth %d, %zu MB hash\n", static_cast<int>(games.size()), options.depth, options.hash_mb);
+    std::printf("%8s %14s %9s %16s %14s\n", "threads", "time-to-depth", "speedup", "nodes", "nodes/s");
+
+    double single_thread_seconds = 0;
+
+    for (int threads = 1; threads <= options.max_threads; threads *= 2) {
+        std::chrono::nanoseconds elapsed{0};
+        std::uint64_t nodes = 0;
+
+        for (const auto &game: games) {
+            // A fresh table per position so every run starts cold
+            SearchPlayer player{
+                game.current_turn(),
+                SearchLimits{.depth = options.depth},
+                SearchOptions{.hash_mb = options.hash_mb, .threads = threads},
+            };
+            auto result = player.search(game);
+
+            elapsed += result.elapsed;
+            nodes += result.nodes;
+        }
+
+        auto seconds = std::chrono::duration<double>(elapsed).count();
+
+        if (threads == 1) {
+            single_thread_seconds = seconds;
+        }
+
+        std::printf(
+            "%8d %12.3f s %8.2fx %16llu %14.0f\n",
+            threads,
+            seconds,
+            single_thread_seconds / seconds,
+            static_cast<unsigned long long>(nodes),
+            static_cast<double>(nodes) / seconds
+        );
+    }
+
+    return 0;
+}
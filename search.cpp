@@ -0,0 +1,553 @@
+#include "search.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <future>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "endgame.h"
+
+constexpr int infinity = std::numeric_limits<int>::max() / 2;
+
+static_assert(64 * eval_scale < win_score, "evaluations must stay below finished game scores");
+
+// Corners first and the cells diagonally next to empty corners last, rows listed top to bottom
+constexpr int square_priority[64] = {
+    0, 4, 1, 2, 2, 1, 4, 0,
+    4, 5, 3, 3, 3, 3, 5, 4,
+    1, 3, 2, 2, 2, 2, 3, 1,
+    2, 3, 2, 0, 0, 2, 3, 2,
+    2, 3, 2, 0, 0, 2, 3, 2,
+    1, 3, 2, 2, 2, 2, 3, 1,
+    4, 5, 3, 3, 3, 3, 5, 4,
+    0, 4, 1, 2, 2, 1, 4, 0,
+};
+
+
+Move square_move(Piece piece, int square) {
+    return Move{.piece = piece, .row = square / 8, .column = square % 8};
+}
+
+int final_score(const Board &board, Piece piece) {
+    auto difference = board.score(piece) - board.score(opponent(piece));
+
+    if (difference > 0) {
+        return win_score + difference;
+    }
+
+    if (difference < 0) {
+        return -win_score + difference;
+    }
+
+    return 0;
+}
+
+int ordered_moves(std::uint64_t moves, int (&squares)[64]) {
+    int count = 0;
+
+    for (; moves != 0; moves &= moves - 1) {
+        squares[count++] = std::countr_zero(moves);
+    }
+
+    std::stable_sort(squares, squares + count, [](int a, int b) {
+        return square_priority[a] < square_priority[b];
+    });
+
+    return count;
+}
+
+// Moves first_square to the front, keeping the order of the others
+void move_to_front(int (&squares)[64], int count, int first_square) {
+    auto found = std::find(squares, squares + count, first_square);
+
+    if (found != squares + count) {
+        std::rotate(squares, found, found + 1);
+    }
+}
+
+// Reading the clock costs more than a node, so the deadline is checked once every this many nodes
+constexpr std::uint64_t clock_check_interval = 1024;
+
+
+class Searcher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Thread 0 is the main search. Other threads are Lazy SMP helpers which only fill the shared table, they may stop
+    // at any time and search every other iteration one ply deeper so they run ahead of the main search.
+    Searcher(
+        const Board &board,
+        SearchLimits limits,
+        Clock::time_point start,
+        TranspositionTable *table,
+        const PatternEvaluator *evaluator,
+        const std::atomic<bool> &stop,
+        int thread_index,
+        const ProgressCallback *progress = nullptr
+    ) : _board{board},
+        _eval_state{board},
+        _limits{limits},
+        _table{table},
+        _evaluator{evaluator},
+        _stop{stop},
+        _progress{progress},
+        _thread_index{thread_index} {
+        if (limits.time.count() != 0) {
+            _deadline = start + limits.time;
+        }
+
+        _can_abort = thread_index != 0;
+    }
+
+    SearchResult iterative_deepening(Piece piece) {
+        auto result = SearchResult{};
+        int squares[64];
+        auto count = ordered_moves(_board.legal_moves(piece), squares);
+
+        if (count == 0) {
+            return result;
+        }
+
+        // Helpers start from a different root move so they do not all walk the same tree
+        std::rotate(squares, squares + _thread_index % count, squares + count);
+
+        result.move = square_move(piece, squares[0]);
+        auto empties = 64 - _board.score(Piece::Black) - _board.score(Piece::White);
+        auto max_depth = std::min(std::max(_limits.depth, 1), empties);
+
+        for (int depth = 1; depth <= max_depth; depth++) {
+            auto best_square = result.move.row * 8 + result.move.column;
+            move_to_front(squares, count, best_square);
+
+            auto search_depth = std::min(depth + _thread_index % 2, max_depth);
+            auto [score, square] = search_root(piece, squares, count, search_depth);
+
+            // A partial iteration is thrown away, its best move may not have seen the refutation yet
+            if (_aborted) {
+                break;
+            }
+
+            result.move = square_move(piece, square);
+            result.score = score;
+            result.depth = search_depth;
+
+            if (_progress != nullptr && *_progress) {
+                (*_progress)(MoveProgress{.move = result.move, .depth = result.depth, .score = result.score});
+            }
+
+            // The first iteration always completes so there is a searched move to fall back on
+            _can_abort = true;
+        }
+
+        result.nodes = _nodes;
+
+        if (_table != nullptr) {
+            _table->add_stats(_table_stats);
+        }
+
+        return result;
+    }
+
+private:
+    std::pair<int, int> search_root(Piece piece, const int (&squares)[64], int count, int depth) {
+        auto alpha = -infinity;
+        auto best_square = squares[0];
+
+        for (int i = 0; i < count; i++) {
+            auto undo = make(square_move(piece, squares[i]));
+            auto score = -negamax(opponent(piece), depth - 1, -infinity, -alpha);
+            unmake(undo);
+
+            if (_aborted) {
+                break;
+            }
+
+            if (score > alpha) {
+                alpha = score;
+                best_square = squares[i];
+            }
+        }
+
+        return {alpha, best_square};
+    }
+
+    // The node budget is a plain compare and is checked on every node, so a search never goes past it. Only the
+    // clock is sampled.
+    bool out_of_budget() {
+        if (!_can_abort) {
+            return false;
+        }
+
+        if (_stop.load(std::memory_order_relaxed)) {
+            return true;
+        }
+
+        if (_limits.nodes != 0 && _nodes >= _limits.nodes) {
+            return true;
+        }
+
+        return _deadline != Clock::time_point{} && _nodes % clock_check_interval == 0 && Clock::now() >= _deadline;
+    }
+
+    // Pattern indices follow the board only when they are used
+    UndoInfo make(Move move) {
+        auto undo = _board.make(move);
+
+        if (_evaluator != nullptr) {
+            _eval_state.update(undo);
+        }
+
+        return undo;
+    }
+
+    void unmake(const UndoInfo &undo) {
+        _board.unmake(undo);
+
+        if (_evaluator != nullptr) {
+            _eval_state.restore(undo);
+        }
+    }
+
+    int evaluate(Piece piece) const {
+        if (_evaluator != nullptr) {
+            return _evaluator->evaluate(_eval_state, piece);
+        }
+
+        return _board.score(piece) - _board.score(opponent(piece));
+    }
+
+    int negamax(Piece piece, int depth, int alpha, int beta) {
+        _nodes++;
+
+        if (out_of_budget()) {
+            _aborted = true;
+            return 0;
+        }
+
+        auto moves = _board.legal_moves(piece);
+
+        if (moves == 0) {
+            if (_board.legal_moves(opponent(piece)) == 0) {
+                return final_score(_board, piece);
+            }
+
+            return -negamax(opponent(piece), depth, -beta, -alpha);
+        }
+
+        if (depth <= 0) {
+            return evaluate(piece);
+        }
+
+        auto key = position_hash(_board, piece);
+        auto table_square = -1;
+
+        if (_table != nullptr) {
+            TranspositionEntry entry;
+
+            if (_table->probe(key, entry)) {
+                _table_stats.hits++;
+                table_square = entry.best_square;
+
+                if (entry.depth >= depth) {
+                    if (entry.bound == Bound::Exact) {
+                        return entry.score;
+                    }
+
+                    if (entry.bound == Bound::Lower && entry.score >= beta) {
+                        return entry.score;
+                    }
+
+                    if (entry.bound == Bound::Upper && entry.score <= alpha) {
+                        return entry.score;
+                    }
+                }
+            } else {
+                _table_stats.misses++;
+            }
+        }
+
+        int squares[64];
+        auto count = ordered_moves(moves, squares);
+        move_to_front(squares, count, table_square);
+
+        auto original_alpha = alpha;
+        auto best = -infinity;
+        auto best_square = squares[0];
+
+        for (int i = 0; i < count; i++) {
+            auto undo = make(square_move(piece, squares[i]));
+            auto score = -negamax(opponent(piece), depth - 1, -beta, -alpha);
+            unmake(undo);
+
+            if (_aborted) {
+                return 0;
+            }
+
+            if (score > best) {
+                best = score;
+                best_square = squares[i];
+            }
+
+            if (score > alpha) {
+                alpha = score;
+            }
+
+            if (alpha >= beta) {
+                break;
+            }
+        }
+
+        if (_table != nullptr) {
+            auto bound = best <= original_alpha ? Bound::Upper : best >= beta ? Bound::Lower : Bound::Exact;
+            auto entry = TranspositionEntry{.score = best, .depth = depth, .bound = bound, .best_square = best_square};
+
+            _table_stats.stores++;
+
+            if (_table->store(key, entry)) {
+                _table_stats.overwrites++;
+            }
+        }
+
+        return best;
+    }
+
+    Board _board;
+    EvalState _eval_state;
+    SearchLimits _limits;
+    TranspositionTable *_table{nullptr};
+    TranspositionStats _table_stats{};
+    const PatternEvaluator *_evaluator{nullptr};
+    const std::atomic<bool> &_stop;
+    // Told about every iteration completed, main search only
+    const ProgressCallback *_progress{nullptr};
+    int _thread_index{0};
+    Clock::time_point _deadline{};
+    std::uint64_t _nodes{0};
+    bool _can_abort{false};
+    bool _aborted{false};
+};
+
+
+double SearchResult::nodes_per_second() const {
+    if (elapsed.count() == 0) {
+        return 0;
+    }
+
+    return static_cast<double>(nodes) / std::chrono::duration<double>(elapsed).count();
+}
+
+
+std::shared_ptr<const PatternEvaluator> selected_evaluator(const SearchOptions &options) {
+    if (options.evaluation == Evaluation::Discs) {
+        return nullptr;
+    }
+
+    if (options.evaluator != nullptr) {
+        return options.evaluator;
+    }
+
+    // Shares the default evaluator without owning it
+    return {std::shared_ptr<void>{}, &default_evaluator()};
+}
+
+
+SearchPlayer::SearchPlayer(Piece piece, SearchLimits limits, SearchOptions options)
+    : _piece{piece},
+      _limits{limits},
+      _threads{std::max(options.threads, 1)},
+      _endgame_empties{options.endgame_empties},
+      _evaluator{selected_evaluator(options)},
+      _book{std::move(options.book)} {
+    if (options.hash_mb != 0) {
+        _table = std::make_unique<TranspositionTable>(options.hash_mb);
+    }
+
+    if (_endgame_empties > 0) {
+        _endgame_table = std::make_unique<TranspositionTable>(endgame_table_megabytes);
+    }
+}
+
+SearchPlayer::~SearchPlayer() {
+    stop_pondering();
+}
+
+Piece SearchPlayer::piece() const {
+    return _piece;
+}
+
+Move SearchPlayer::choose_move(const Game &game, std::stop_token stop, const ProgressCallback &progress) const {
+    _last_result = search(game, std::move(stop), progress);
+    return _last_result.move;
+}
+
+std::optional<Move> SearchPlayer::ponder(const Game &game) {
+    stop_pondering();
+
+    if (_table == nullptr || game.status() != GameStatus::Continue || game.current_turn() == _piece) {
+        return std::nullopt;
+    }
+
+    // The reply the last search expected
+    TranspositionEntry entry;
+    auto opponent_piece = opponent(_piece);
+
+    if (!_table->probe(position_hash(game.board(), opponent_piece), entry) || entry.best_square < 0 ||
+        (game.board().legal_moves(opponent_piece) >> entry.best_square & 1) == 0) {
+        return std::nullopt;
+    }
+
+    auto reply = square_move(opponent_piece, entry.best_square);
+    auto board = game.board();
+    board.make(reply);
+
+    // Solving can't be stopped and the book answers at once, neither is worth pondering
+    auto empties = 64 - board.score(Piece::Black) - board.score(Piece::White);
+
+    if (board.legal_moves(_piece) == 0 || empties <= _endgame_empties ||
+        (_book != nullptr && _book->probe(board, _piece))) {
+        return std::nullopt;
+    }
+
+    // Unlimited in time, the remaining budget is given on a ponder hit
+    auto limits = SearchLimits{.depth = _limits.depth, .nodes = _limits.nodes};
+
+    _ponder = std::make_unique<Ponder>();
+    _ponder->board = board;
+    _ponder->to_move = _piece;
+    _ponder->result = std::async(std::launch::async, [this, board, limits, &stop = _ponder->stop] {
+        return search_board(board, limits, Searcher::Clock::now(), stop, nullptr);
+    });
+
+    return reply;
+}
+
+void SearchPlayer::stop_pondering() const {
+    if (_ponder != nullptr) {
+        _ponder->stop = true;
+        _ponder->result.wait();
+        _ponder.reset();
+    }
+}
+
+bool SearchPlayer::pondering() const {
+    return _ponder != nullptr;
+}
+
+SearchResult SearchPlayer::search(const Game &game, std::stop_token stop, const ProgressCallback &progress) const {
+    auto start = Searcher::Clock::now();
+
+    if (_ponder != nullptr && _ponder->board == game.board() && _ponder->to_move == game.current_turn()) {
+        // Outlives the stop callback
+        auto ponder = std::move(_ponder);
+        std::stop_callback stop_ponder{stop, [&] {
+            ponder->stop = true;
+        }};
+
+        // Already searching since the opponent's move started, it gets the time a new search would have had. Without
+        // a time limit it finishes at the depth or node limit.
+        if (_limits.time.count() != 0) {
+            ponder->result.wait_until(start + _limits.time);
+            ponder->stop = true;
+        }
+
+        auto result = ponder->result.get();
+        result.elapsed = Searcher::Clock::now() - start;
+        result.ponder_hit = true;
+
+        if (progress) {
+            progress(MoveProgress{.move = result.move, .depth = result.depth, .score = result.score});
+        }
+
+        return result;
+    }
+
+    stop_pondering();
+    auto empties = 64 - game.board().score(Piece::Black) - game.board().score(Piece::White);
+
+    if (auto book_move = _book != nullptr ? _book->probe(game.board(), _piece) : std::nullopt; book_move) {
+        auto square = book_move->move.row * 8 + book_move->move.column;
+
+        // A book built for other rules or a hash collision could give anything
+        if (game.board().legal_moves(_piece) >> square & 1) {
+            return SearchResult{
+                .move = book_move->move,
+                .score = book_move->score,
+                .depth = book_move->depth,
+                .elapsed = Searcher::Clock::now() - start,
+            };
+        }
+    }
+
+    if (empties <= _endgame_empties) {
+        auto solved = solve_endgame(game.board(), _piece, *_endgame_table);
+        auto score = solved.score > 0 ? win_score + solved.score : solved.score < 0 ? -win_score + solved.score : 0;
+
+        return SearchResult{
+            .move = solved.move,
+            .score = score,
+            .depth = empties,
+            .nodes = solved.nodes,
+            .elapsed = Searcher::Clock::now() - start,
+        };
+    }
+
+    std::atomic<bool> stop_search{false};
+    std::stop_callback stop_callback{stop, [&] {
+        stop_search = true;
+    }};
+
+    return search_board(game.board(), _limits, start, stop_search, &progress);
+}
+
+SearchResult SearchPlayer::search_board(
+    const Board &board,
+    SearchLimits limits,
+    std::chrono::steady_clock::time_point start,
+    std::atomic<bool> &stop,
+    const ProgressCallback *progress
+) const {
+    if (_table != nullptr) {
+        _table->new_search();
+    }
+
+    std::vector<std::uint64_t> helper_nodes(_threads - 1);
+    std::vector<std::thread> helpers;
+
+    // Helpers are bounded by the depth limit and the stop flag, the main search alone decides when to finish
+    auto helper_limits = SearchLimits{.depth = limits.depth};
+
+    for (int i = 1; i < _threads; i++) {
+        helpers.emplace_back([&, i] {
+            Searcher helper{board, helper_limits, start, _table.get(), _evaluator.get(), stop, i};
+            helper_nodes[i - 1] = helper.iterative_deepening(_piece).nodes;
+        });
+    }
+
+    Searcher searcher{board, limits, start, _table.get(), _evaluator.get(), stop, 0, progress};
+    auto result = searcher.iterative_deepening(_piece);
+
+    stop = true;
+
+    for (auto &helper: helpers) {
+        helper.join();
+    }
+
+    for (auto nodes: helper_nodes) {
+        result.nodes += nodes;
+    }
+
+    result.elapsed = Searcher::Clock::now() - start;
+    return result;
+}
+
+const SearchResult &SearchPlayer::last_result() const {
+    return _last_result;
+}
+
+const TranspositionTable *SearchPlayer::transposition_table() const {
+    return _table.get();
+}
@@ -0,0 +1,131 @@
+#ifndef REVERSI_SEARCH_H
+#define REVERSI_SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+
+#include "book.h"
+#include "eval.h"
+#include "reversi.h"
+#include "transposition.h"
+
+
+struct SearchLimits {
+    int depth{6};
+    // Stop after the main search thread visited this many nodes, 0 for no limit
+    std::uint64_t nodes{0};
+    // Wall-clock budget per move, 0 for no limit
+    std::chrono::milliseconds time{0};
+};
+
+
+struct SearchOptions {
+    // Transposition table size, 0 to search without one
+    std::size_t hash_mb{16};
+    // Threads searching the root together through the shared table. The helpers are threads of their own, also when
+    // the move is chosen on a ThreadPool, so players sharing a pool keep this at 1.
+    int threads{1};
+    // Positions with at most this many empty cells are solved exactly instead, ignoring the time limit
+    int endgame_empties{16};
+    Evaluation evaluation{Evaluation::Patterns};
+    // Weights for Evaluation::Patterns, the built-in ones if empty
+    std::shared_ptr<const PatternEvaluator> evaluator{};
+    // Positions found in it are played from the book without searching
+    std::shared_ptr<const OpeningBook> book{};
+};
+
+
+struct SearchResult {
+    Move move{};
+    // From the searching side, in the units of the evaluation used. Finished games score beyond win_score by the
+    // disc difference
+    int score{0};
+    // Last depth searched completely, or the depth of the book entry
+    int depth{0};
+    // Summed over all search threads
+    std::uint64_t nodes{0};
+    std::chrono::nanoseconds elapsed{0};
+    // The position was the one pondered, elapsed only counts the time since the search was asked for
+    bool ponder_hit{false};
+
+    [[nodiscard]] double nodes_per_second() const;
+};
+
+
+constexpr int win_score = 1000;
+
+
+// Negamax with alpha-beta pruning, deepened one ply at a time until the depth, node or time limit is reached.
+// The move returned is always from the last depth searched completely.
+class SearchPlayer : public Player {
+public:
+    explicit SearchPlayer(Piece piece, SearchLimits limits = {}, SearchOptions options = {});
+
+    ~SearchPlayer() override;
+
+    [[nodiscard]] Piece piece() const override;
+
+    // A stop request ends the search after its first iteration, except when solving the endgame which can't be
+    // stopped. Progress is reported after every iteration.
+    [[nodiscard]] SearchResult search(
+        const Game &game, std::stop_token stop = {}, const ProgressCallback &progress = {}
+    ) const;
+
+    // Result of the search behind the last move chosen
+    [[nodiscard]] const SearchResult &last_result() const;
+
+    // Kept across moves, nullptr if searching without one
+    [[nodiscard]] const TranspositionTable *transposition_table() const;
+
+    // Searches in the background, while the opponent thinks about its move in game, the position after the reply the
+    // last search expected. If the opponent plays it, the next search continues from there instead of starting over.
+    // Returns the expected reply, nothing if there's no prediction or it is not worth pondering.
+    std::optional<Move> ponder(const Game &game);
+
+    void stop_pondering() const;
+
+    [[nodiscard]] bool pondering() const;
+
+protected:
+    [[nodiscard]] Move choose_move(
+        const Game &game, std::stop_token stop, const ProgressCallback &progress
+    ) const override;
+
+private:
+    struct Ponder {
+        Board board{};
+        // The same discs with the other side to move are a different position
+        Piece to_move{Piece::Black};
+        std::atomic<bool> stop{false};
+        std::future<SearchResult> result{};
+    };
+
+    // progress may be nullptr
+    [[nodiscard]] SearchResult search_board(
+        const Board &board,
+        SearchLimits limits,
+        std::chrono::steady_clock::time_point start,
+        std::atomic<bool> &stop,
+        const ProgressCallback *progress
+    ) const;
+
+    const Piece _piece{Piece::Black};
+    const SearchLimits _limits{};
+    const int _threads{1};
+    const int _endgame_empties{0};
+    // nullptr to evaluate by disc difference
+    const std::shared_ptr<const PatternEvaluator> _evaluator{};
+    const std::shared_ptr<const OpeningBook> _book{};
+    std::unique_ptr<TranspositionTable> _table{};
+    // Kept across endgame solves, nullptr if the endgame is never solved
+    std::unique_ptr<TranspositionTable> _endgame_table{};
+    mutable SearchResult _last_result{};
+    mutable std::unique_ptr<Ponder> _ponder{};
+};
+
+#endif //REVERSI_SEARCH_H
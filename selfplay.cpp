@@ -0,0 +1,286 @@
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game_record.h"
+#include "mcts.h"
+#include "positions.h"
+#include "reversi.h"
+#include "search.h"
+
+// Plays games between two engine players on every core without any console output. Each game starts with a number
+// of uniformly random moves so the games differ, then the players take over. Finished games are appended to a game
+// record file as they complete, and every position of them can also be written labelled with the final result for
+// train.
+
+struct Options {
+    int games{1000};
+    int threads{static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u))};
+    std::string black{"search:4"};
+    std::string white{"search:4"};
+    int random_moves{8};
+    std::uint64_t seed{1};
+    std::size_t hash_mb{4};
+    // Search players solve exactly from this many empties, lower than in play as solving dominates short searches
+    int endgame_empties{12};
+    std::string output{"selfplay.bin"};
+    // Labelled positions for train, none written if empty
+    std::string positions{};
+};
+
+Move random_move(const Game &game, std::mt19937_64 &random) {
+    auto moves = game.board().legal_moves(game.current_turn());
+
+    for (auto skip = random() % std::popcount(moves); skip > 0; skip--) {
+        moves &= moves - 1;
+    }
+
+    auto square = std::countr_zero(moves);
+    return Move{.piece = game.current_turn(), .row = square / 8, .column = square % 8};
+}
+
+class RandomPlayer : public Player {
+public:
+    RandomPlayer(Piece piece, std::uint64_t seed) : _piece{piece}, _random{seed} {}
+
+    [[nodiscard]] Piece piece() const override {
+        return _piece;
+    }
+
+protected:
+    [[nodiscard]] Move choose_move(const Game &game, std::stop_token, const ProgressCallback &) const override {
+        return random_move(game, _random);
+    }
+
+private:
+    const Piece _piece{Piece::Black};
+    mutable std::mt19937_64 _random;
+};
+
+// "random", "greedy", "search:<depth>" or "mcts:<playouts>", nullptr for anything else
+std::unique_ptr<Player> make_player(const std::string &spec, Piece piece, std::uint64_t seed, const Options &options) {
+    if (spec == "random") {
+        return std::make_unique<RandomPlayer>(piece, seed);
+    }
+
+    if (spec == "greedy") {
+        return std::make_unique<CpuPlayer>(piece);
+    }
+
+    if (spec.starts_with("search:")) {
+        int depth;
+
+        try {
+            depth = std::stoi(spec.substr(7));
+        } catch (const std::exception &) {
+            return nullptr;
+        }
+
+        auto search_options = SearchOptions{.hash_mb = options.hash_mb, .endgame_empties = options.endgame_empties};
+        return std::make_unique<SearchPlayer>(piece, SearchLimits{.depth = depth}, search_options);
+    }
+
+    if (spec.starts_with("mcts:")) {
+        std::uint64_t playouts;
+
+        try {
+            playouts = std::stoull(spec.substr(5));
+        } catch (const std::exception &) {
+            return nullptr;
+        }
+
+        if (playouts == 0) {
+            return nullptr;
+        }
+
+        return std::make_unique<MctsPlayer>(piece, MctsLimits{.playouts = playouts}, MctsOptions{.seed = seed});
+    }
+
+    return nullptr;
+}
+
+struct PlayedGame {
+    GameRecord record{};
+    std::vector<Board> boards{};
+};
+
+PlayedGame play_game(Player &black, Player &white, int random_moves, std::mt19937_64 &random) {
+    PlayedGame played;
+    Game game;
+
+    while (game.status() == GameStatus::Continue) {
+        auto &player = game.current_turn() == Piece::Black ? black : white;
+        auto opening = game.move_count() < random_moves;
+        auto move = opening ? random_move(game, random) : player.get_next_move(game);
+
+        auto board = game.board();
+
+        if (game.next_move(move.piece, move.row, move.column) == MoveStatus::Error) {
+            break;
+        }
+
+        played.boards.push_back(board);
+        played.record.add(move);
+        played.record.header.opening_moves += opening;
+    }
+
+    played.record.header.source = GameSource::SelfPlay;
+    played.record.finish(game.board());
+    return played;
+}
+
+class GameSink {
+public:
+    explicit GameSink(const Options &options) : _games{options.output} {
+        if (!options.positions.empty()) {
+            _positions.emplace(options.positions);
+        }
+    }
+
+    [[nodiscard]] bool good() const {
+        return _games.good() && (!_positions || _positions->good());
+    }
+
+    void add(const PlayedGame &game) {
+        std::lock_guard lock{_mutex};
+
+        const auto &header = game.record.header;
+        _games.write(game.record);
+
+        if (_positions) {
+            for (const auto &board: game.boards) {
+                _positions->write(board, header.black_score);
+            }
+        }
+
+        _moves += header.move_count;
+        _black_wins += header.black_score > 0;
+        _white_wins += header.black_score < 0;
+        _count++;
+    }
+
+    void print_summary(std::chrono::duration<double> elapsed) const {
+        std::printf(
+            "%d games, %llu moves in %.2f s: %.1f games/s, %.0f moves/s\n", _count,
+            static_cast<unsigned long long>(_moves), elapsed.count(), _count / elapsed.count(),
+            static_cast<double>(_moves) / elapsed.count()
+        );
+        std::printf(
+            "black wins %d, white wins %d, draws %d\n", _black_wins, _white_wins, _count - _black_wins - _white_wins
+        );
+    }
+
+private:
+    std::mutex _mutex;
+    GameRecordWriter _games;
+    std::optional<PositionWriter> _positions{};
+    std::uint64_t _moves{0};
+    int _count{0};
+    int _black_wins{0};
+    int _white_wins{0};
+};
+
+bool parse_options(int argc, char *argv[], Options &options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        auto option = std::string{argv[i]};
+
+        try {
+            if (option == "--games") {
+                options.games = std::stoi(argv[i + 1]);
+            } else if (option == "--threads") {
+                options.threads = std::max(std::stoi(argv[i + 1]), 1);
+            } else if (option == "--black") {
+                options.black = argv[i + 1];
+            } else if (option == "--white") {
+                options.white = argv[i + 1];
+            } else if (option == "--random-moves") {
+                options.random_moves = std::stoi(argv[i + 1]);
+            } else if (option == "--seed") {
+                options.seed = std::stoull(argv[i + 1]);
+            } else if (option == "--hash-mb") {
+                options.hash_mb = std::stoul(argv[i + 1]);
+            } else if (option == "--endgame-empties") {
+                options.endgame_empties = std::stoi(argv[i + 1]);
+            } else if (option == "--output") {
+                options.output = argv[i + 1];
+            } else if (option == "--positions") {
+                options.positions = argv[i + 1];
+            } else {
+                return false;
+            }
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    auto check = options;
+    check.hash_mb = 0;
+
+    if (make_player(options.black, Piece::Black, 0, check) == nullptr ||
+        make_player(options.white, Piece::White, 0, check) == nullptr) {
+        return false;
+    }
+
+    return argc % 2 == 1;
+}
+
+int main(int argc, char *argv[]) {
+    auto options = Options{};
+
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--games <count>] [--threads <threads>] [--black <player>]"
+                  << " [--white <player>] [--random-moves <plies>] [--seed <seed>] [--hash-mb <megabytes>]"
+                  << " [--endgame-empties <empties>] [--output <path>] [--positions <path>]" << std::endl
+                  << "Players are random, greedy, search:<depth> or mcts:<playouts>" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<GameSink> sink;
+
+    try {
+        sink = std::make_unique<GameSink>(options);
+    } catch (const std::runtime_error &error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    std::atomic<int> next_game{0};
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int thread = 0; thread < options.threads; thread++) {
+        workers.emplace_back([&, thread] {
+            // Players are per thread, search players keep their table from game to game
+            auto black = make_player(options.black, Piece::Black, options.seed * 2 + thread, options);
+            auto white = make_player(options.white, Piece::White, options.seed * 3 + thread, options);
+
+            for (auto index = next_game++; index < options.games; index = next_game++) {
+                // Openings depend on the game number only, not on which thread plays it
+                std::mt19937_64 random{options.seed ^ (static_cast<std::uint64_t>(index) * 0x9e3779b97f4a7c15)};
+                sink->add(play_game(*black, *white, options.random_moves, random));
+            }
+        });
+    }
+
+    for (auto &worker: workers) {
+        worker.join();
+    }
+
+    sink->print_summary(std::chrono::steady_clock::now() - start);
+
+    if (!sink->good()) {
+        std::cerr << "Can't write " << options.output << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
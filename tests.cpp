@@ -1,9 +1,27 @@
 #define CATCH_CONFIG_MAIN
 
+#include <atomic>
+#include <bit>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <random>
+#include <thread>
+#include <type_traits>
 
 #include "catch_amalgamated.hpp"
+#include "bitboard.h"
+#include "book.h"
+#include "endgame.h"
+#include "eval.h"
+#include "game_record.h"
+#include "importers.h"
+#include "mcts.h"
+#include "positions.h"
 #include "reversi.h"
+#include "search.h"
+#include "thread_pool.h"
+#include "transposition.h"
 
 SCENARIO("Get cell content from Board", "[Board]") {
     GIVEN("default new Board") {
@@ -423,6 +441,44 @@ SCENARIO("Put piece onto board pre-filled with enemy neighbors", "[Board]") {
     }
 }
 
+SCENARIO("Put piece at the end of a full row of enemies", "[Board]") {
+    GIVEN("A board with six white pieces between a black piece and an empty corner") {
+        Board board{
+            {
+                {Cell::Black, Cell::White, Cell::White, Cell::White, Cell::White, Cell::White, Cell::White, Cell::Empty},
+                {Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty},
+                {Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty},
+                {Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty},
+                {Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty},
+                {Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty},
+                {Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty},
+                {Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::White},
+            }
+        };
+
+        THEN("white can't put on the corner") {
+            REQUIRE(board.put(Piece::White, 0, 7) == Result::Error);
+        }
+
+        WHEN("a black piece is put on the corner") {
+            auto result = board.put(Piece::Black, 0, 7);
+
+            THEN("result is ok") {
+                REQUIRE(result == Result::Ok);
+            }
+
+            THEN("flip all six white pieces") {
+                REQUIRE(board.score(Piece::Black) == 8);
+                REQUIRE(board.score(Piece::White) == 1);
+            }
+
+            THEN("don't flip the white piece on the other corner") {
+                REQUIRE(board.get(7, 7) == Cell::White);
+            }
+        }
+    }
+}
+
 SCENARIO("Calculate score", "[Board]") {
     GIVEN("A board with random pieces") {
         Board board{
@@ -448,6 +504,302 @@ SCENARIO("Calculate score", "[Board]") {
     }
 }
 
+SCENARIO("Calculate legal moves", "[Board]") {
+    GIVEN("new Board") {
+        Board board;
+
+        THEN("black has 4 legal moves around the center") {
+            auto expected = (std::uint64_t{1} << (2 * 8 + 3)) | (std::uint64_t{1} << (3 * 8 + 2)) |
+                            (std::uint64_t{1} << (4 * 8 + 5)) | (std::uint64_t{1} << (5 * 8 + 4));
+            REQUIRE(board.legal_moves(Piece::Black) == expected);
+        }
+
+        THEN("white has 4 legal moves around the center") {
+            auto expected = (std::uint64_t{1} << (2 * 8 + 4)) | (std::uint64_t{1} << (3 * 8 + 5)) |
+                            (std::uint64_t{1} << (4 * 8 + 2)) | (std::uint64_t{1} << (5 * 8 + 3));
+            REQUIRE(board.legal_moves(Piece::White) == expected);
+        }
+    }
+
+    GIVEN("A board with random pieces") {
+        Board board{
+            {
+                {Cell::Black, Cell::Empty, Cell::Empty, Cell::Black, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty},
+                {Cell::Empty, Cell::White, Cell::Empty, Cell::White, Cell::Empty, Cell::White, Cell::Empty, Cell::Empty},
+                {Cell::Empty, Cell::Empty, Cell::White, Cell::White, Cell::White, Cell::Empty, Cell::Empty, Cell::Empty},
+                {Cell::Black, Cell::White, Cell::White, Cell::Empty, Cell::White, Cell::White, Cell::Empty, Cell::Empty},
+                {Cell::Empty, Cell::Empty, Cell::White, Cell::White, Cell::White, Cell::Empty, Cell::Empty, Cell::Empty},
+                {Cell::Empty, Cell::White, Cell::Empty, Cell::White, Cell::Empty, Cell::White, Cell::Empty, Cell::Empty},
+                {Cell::Black, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty},
+                {Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Empty, Cell::Black},
+            }
+        };
+
+        THEN("legal moves are exactly the cells where put succeeds") {
+            for (auto piece: {Piece::Black, Piece::White}) {
+                auto moves = board.legal_moves(piece);
+
+                for (int i = 0; i < 8; i++) {
+                    for (int j = 0; j < 8; j++) {
+                        Board copy_board = board;
+                        auto is_legal = (moves >> (i * 8 + j)) & 1;
+                        REQUIRE((copy_board.put(piece, i, j) == Result::Ok) == (is_legal == 1));
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("SIMD bitboard kernels match scalar kernels", "[Bitboard]") {
+    GIVEN("positions from random games") {
+        std::mt19937_64 random{20231018};
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> positions;
+
+        for (int game = 0; game < 50; game++) {
+            std::uint64_t own = 0x0000000810000000;
+            std::uint64_t enemy = 0x0000001008000000;
+
+            for (int ply = 0; ply < 60; ply++) {
+                positions.emplace_back(own, enemy);
+                positions.emplace_back(random(), random());
+
+                auto moves = legal_move_mask(own, enemy);
+
+                if (moves == 0) {
+                    std::swap(own, enemy);
+                    continue;
+                }
+
+                for (auto skip = random() % std::popcount(moves); skip > 0; skip--) {
+                    moves &= moves - 1;
+                }
+
+                auto move = moves & (0 - moves);
+                auto flipped = flip_mask(own, enemy, move);
+                own |= flipped | move;
+                enemy &= ~flipped;
+                std::swap(own, enemy);
+            }
+        }
+
+        const auto &scalar = bitboard_kernels(SimdLevel::Scalar);
+
+        THEN("legal moves and flips are identical") {
+            for (auto level: {SimdLevel::Sse41, SimdLevel::Avx2}) {
+                if (level > detected_simd_level()) {
+                    continue;
+                }
+
+                const auto &kernels = bitboard_kernels(level);
+
+                for (auto [own, enemy]: positions) {
+                    enemy &= ~own;
+                    REQUIRE(kernels.legal_moves(own, enemy) == scalar.legal_moves(own, enemy));
+
+                    for (int square = 0; square < 64; square++) {
+                        auto move = std::uint64_t{1} << square;
+
+                        if (((own | enemy) & move) == 0) {
+                            REQUIRE(kernels.flips(own, enemy, move) == scalar.flips(own, enemy, move));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Make and unmake moves", "[Board]") {
+    GIVEN("new Board") {
+        Board board;
+
+        WHEN("a legal move is made") {
+            auto undo = board.make(Move{.piece = Piece::Black, .row = 2, .column = 3});
+
+            THEN("flipped mask has the flipped white piece") {
+                REQUIRE(undo.flipped == (std::uint64_t{1} << (3 * 8 + 3)));
+            }
+
+            THEN("board is the same as after put") {
+                Board put_board;
+                REQUIRE(put_board.put(Piece::Black, 2, 3) == Result::Ok);
+                REQUIRE(board == put_board);
+            }
+
+            THEN("unmake restores the board") {
+                board.unmake(undo);
+                REQUIRE(board == Board{});
+            }
+        }
+
+        WHEN("an illegal move is made") {
+            auto undo = board.make(Move{.piece = Piece::Black, .row = 0, .column = 0});
+
+            THEN("nothing is flipped") {
+                REQUIRE(undo.flipped == 0);
+            }
+
+            THEN("board is unchanged before and after unmake") {
+                REQUIRE(board == Board{});
+                board.unmake(undo);
+                REQUIRE(board == Board{});
+            }
+        }
+
+        WHEN("a sequence of moves is made and unmade in reverse order") {
+            std::vector<UndoInfo> undos;
+            auto piece = Piece::Black;
+
+            for (int i = 0; i < 20; i++) {
+                auto moves = board.legal_moves(piece);
+
+                if (moves != 0) {
+                    auto square = std::countr_zero(moves);
+                    undos.push_back(board.make(Move{.piece = piece, .row = square / 8, .column = square % 8}));
+                }
+
+                piece = piece == Piece::Black ? Piece::White : Piece::Black;
+            }
+
+            THEN("board returns to the start") {
+                REQUIRE(undos.size() > 10);
+
+                for (auto it = undos.rbegin(); it != undos.rend(); it++) {
+                    board.unmake(*it);
+                }
+
+                REQUIRE(board == Board{});
+            }
+        }
+    }
+}
+
+SCENARIO("Hash positions", "[Board]") {
+    GIVEN("new Board") {
+        Board board;
+
+        THEN("hash is the same as an equal board built from cells") {
+            std::vector<std::vector<Cell>> cells(8, std::vector<Cell>(8, Cell::Empty));
+            cells[3][3] = Cell::White;
+            cells[3][4] = Cell::Black;
+            cells[4][3] = Cell::Black;
+            cells[4][4] = Cell::White;
+            REQUIRE(Board{cells}.hash() == board.hash());
+        }
+
+        WHEN("moves are put") {
+            REQUIRE(board.put(Piece::Black, 2, 3) == Result::Ok);
+            REQUIRE(board.put(Piece::White, 2, 2) == Result::Ok);
+
+            THEN("hash is updated to the hash of the resulting position") {
+                std::vector<std::vector<Cell>> cells(8, std::vector<Cell>(8, Cell::Empty));
+                cells[2][2] = Cell::White;
+                cells[2][3] = Cell::Black;
+                cells[3][3] = Cell::White;
+                cells[3][4] = Cell::Black;
+                cells[4][3] = Cell::Black;
+                cells[4][4] = Cell::White;
+                REQUIRE(Board{cells} == board);
+                REQUIRE(Board{cells}.hash() == board.hash());
+            }
+
+            THEN("hash is different from the start") {
+                REQUIRE(board.hash() != Board{}.hash());
+            }
+        }
+
+        WHEN("transposed move orders reach the same position") {
+            Board other;
+            REQUIRE(board.put(Piece::Black, 2, 3) == Result::Ok);
+            REQUIRE(board.put(Piece::White, 2, 2) == Result::Ok);
+            REQUIRE(board.put(Piece::Black, 3, 2) == Result::Ok);
+            REQUIRE(other.put(Piece::Black, 3, 2) == Result::Ok);
+            REQUIRE(other.put(Piece::White, 2, 2) == Result::Ok);
+            REQUIRE(other.put(Piece::Black, 2, 3) == Result::Ok);
+
+            THEN("hashes are equal") {
+                REQUIRE(board == other);
+                REQUIRE(board.hash() == other.hash());
+            }
+        }
+
+        WHEN("a move is made and unmade") {
+            auto undo = board.make(Move{.piece = Piece::Black, .row = 4, .column = 5});
+            REQUIRE(board.hash() != Board{}.hash());
+            board.unmake(undo);
+
+            THEN("hash is restored") {
+                REQUIRE(board.hash() == Board{}.hash());
+            }
+        }
+    }
+
+    GIVEN("games with black and white to move") {
+        Game black_to_move;
+        Game after_move;
+        REQUIRE(after_move.next_move(Piece::Black, 2, 3) == MoveStatus::Continue);
+
+        THEN("game hash includes the side to move") {
+            REQUIRE(black_to_move.hash() == Board{}.hash());
+            REQUIRE(after_move.hash() != after_move.board().hash());
+        }
+    }
+}
+
+SCENARIO("Play moves from text", "[Game]") {
+    GIVEN("new Game") {
+        Game game;
+
+        THEN("moves in column letter and row number are played in order") {
+            REQUIRE(play_moves(game, "f5D6c3"));
+            REQUIRE(game.move_count() == 3);
+            REQUIRE(game.board().get(4, 5) == Cell::Black);
+            REQUIRE(game.board().get(5, 3) == Cell::White);
+            REQUIRE(game.board().get(2, 2) == Cell::Black);
+            REQUIRE(game.current_turn() == Piece::White);
+        }
+
+        THEN("illegal moves stop the sequence") {
+            REQUIRE_FALSE(play_moves(game, "f5a1"));
+            REQUIRE(game.move_count() == 1);
+        }
+
+        THEN("malformed moves are rejected") {
+            REQUIRE_FALSE(play_moves(game, "f"));
+            REQUIRE_FALSE(play_moves(game, "i5"));
+            REQUIRE_FALSE(play_moves(game, "f9"));
+            REQUIRE(game.move_count() == 0);
+        }
+    }
+}
+
+SCENARIO("Copy board", "[Board]") {
+    GIVEN("new Board") {
+        Board board;
+
+        THEN("board is trivially copyable") {
+            STATIC_REQUIRE(std::is_trivially_copyable_v<Board>);
+        }
+
+        WHEN("a copy is modified") {
+            Board copy_board = board;
+            REQUIRE(copy_board == board);
+            REQUIRE(copy_board.put(Piece::Black, 2, 3) == Result::Ok);
+
+            THEN("copy is different from the original") {
+                REQUIRE_FALSE(copy_board == board);
+            }
+
+            THEN("original board is unchanged") {
+                REQUIRE(board == Board{});
+                REQUIRE(board.get(2, 3) == Cell::Empty);
+                REQUIRE(board.get(3, 3) == Cell::White);
+            }
+        }
+    }
+}
+
 SCENARIO("Game with board, turns, and players") {
     GIVEN("New game") {
         Game game;
@@ -692,4 +1044,1364 @@ SCENARIO("CPU moves legally") {
             REQUIRE(game.status() == GameStatus::GameOver);
         }
     }
-}
\ No newline at end of file
+}
+
+int minimax(Board &board, Piece piece, int depth) {
+    auto moves = board.legal_moves(piece);
+
+    if (moves == 0) {
+        if (board.legal_moves(opponent(piece)) == 0) {
+            auto difference = board.score(piece) - board.score(opponent(piece));
+            return difference > 0 ? win_score + difference : difference < 0 ? -win_score + difference : 0;
+        }
+
+        return -minimax(board, opponent(piece), depth);
+    }
+
+    if (depth == 0) {
+        return board.score(piece) - board.score(opponent(piece));
+    }
+
+    auto best = -1000000;
+
+    for (; moves != 0; moves &= moves - 1) {
+        auto square = std::countr_zero(moves);
+        auto undo = board.make(Move{.piece = piece, .row = square / 8, .column = square % 8});
+        best = std::max(best, -minimax(board, opponent(piece), depth - 1));
+        board.unmake(undo);
+    }
+
+    return best;
+}
+
+SCENARIO("Search player", "[Search]") {
+    GIVEN("new Game") {
+        Game game;
+
+        THEN("search player moves legally until game over") {
+            SearchPlayer player1{Piece::Black, SearchLimits{.depth = 3}};
+            SearchPlayer player2{Piece::White, SearchLimits{.depth = 2}};
+
+            while (game.status() == GameStatus::Continue) {
+                const auto &player = game.current_turn() == Piece::Black ? player1 : player2;
+                auto move = player.get_next_move(game);
+
+                REQUIRE(move.piece == player.piece());
+                REQUIRE(game.next_move(move.piece, move.row, move.column) != MoveStatus::Error);
+                REQUIRE(player.last_result().nodes > 0);
+            }
+        }
+
+        THEN("alpha-beta score equals plain minimax score") {
+            std::mt19937_64 random{7};
+
+            while (game.status() == GameStatus::Continue) {
+                for (int depth = 1; depth <= 4; depth++) {
+                    auto options = SearchOptions{.hash_mb = 0, .endgame_empties = 0, .evaluation = Evaluation::Discs};
+                    SearchPlayer player{game.current_turn(), SearchLimits{.depth = depth}, options};
+                    auto board = game.board();
+                    REQUIRE(player.search(game).score == minimax(board, game.current_turn(), depth));
+                }
+
+                auto moves = game.board().legal_moves(game.current_turn());
+
+                for (auto skip = random() % std::popcount(moves); skip > 0; skip--) {
+                    moves &= moves - 1;
+                }
+
+                auto square = std::countr_zero(moves);
+                REQUIRE(game.next_move(game.current_turn(), square / 8, square % 8) != MoveStatus::Error);
+            }
+        }
+
+        THEN("multi-threaded search gives a legal move and counts nodes of every thread") {
+            // Without a table the main thread searches exactly as a single thread would, the rest are helper nodes
+            SearchPlayer single{Piece::Black, SearchLimits{.depth = 8}, SearchOptions{.hash_mb = 0}};
+            SearchPlayer player{Piece::Black, SearchLimits{.depth = 8}, SearchOptions{.hash_mb = 0, .threads = 4}};
+            auto result = player.search(game);
+
+            REQUIRE(result.depth == 8);
+            REQUIRE(result.nodes > single.search(game).nodes);
+            REQUIRE(game.next_move(result.move.piece, result.move.row, result.move.column) != MoveStatus::Error);
+        }
+
+        THEN("search stops at the node budget with a legal move") {
+            SearchPlayer player{Piece::Black, SearchLimits{.depth = 20, .nodes = 1000}};
+            auto result = player.search(game);
+
+            REQUIRE(result.nodes <= 1000);
+            REQUIRE(game.next_move(result.move.piece, result.move.row, result.move.column) != MoveStatus::Error);
+        }
+
+        THEN("search stops at the deadline with the move of the last completed depth") {
+            SearchPlayer player{Piece::Black, SearchLimits{.depth = 60, .time = std::chrono::milliseconds{50}}};
+            auto result = player.search(game);
+
+            REQUIRE(result.depth >= 1);
+            REQUIRE(result.depth < 60);
+            REQUIRE(result.elapsed < std::chrono::milliseconds{250});
+            REQUIRE(game.next_move(result.move.piece, result.move.row, result.move.column) != MoveStatus::Error);
+        }
+
+        THEN("deepening with no time limit reaches the requested depth") {
+            SearchPlayer player{Piece::Black, SearchLimits{.depth = 5}};
+            auto result = player.search(game);
+
+            REQUIRE(result.depth == 5);
+        }
+    }
+
+    GIVEN("Game where black can end the game with a win") {
+        Game game{
+            Board{
+                {
+                    {Cell::Empty, Cell::White, Cell::Black, Cell::Black, Cell::Black, Cell::Empty, Cell::White, Cell::Black},
+                    {Cell::Empty, Cell::White, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black},
+                    {Cell::Empty, Cell::White, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black},
+                    {Cell::Empty, Cell::White, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black},
+                    {Cell::Empty, Cell::White, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black},
+                    {Cell::Empty, Cell::White, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black},
+                    {Cell::Empty, Cell::White, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black},
+                    {Cell::Empty, Cell::White, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black, Cell::Black},
+                }
+            }
+        };
+
+        THEN("search sees the won game") {
+            SearchPlayer player{Piece::Black, SearchLimits{.depth = 10}};
+            auto result = player.search(game);
+
+            REQUIRE(result.score == win_score + 64);
+        }
+    }
+}
+
+SCENARIO("Pondering", "[Search]") {
+    GIVEN("a search player that moved in a new game") {
+        Game game;
+        auto options = SearchOptions{.hash_mb = 4, .endgame_empties = 0};
+        SearchPlayer player{Piece::Black, SearchLimits{.depth = 5}, options};
+        auto move = player.get_next_move(game);
+        REQUIRE(game.next_move(move.piece, move.row, move.column) != MoveStatus::Error);
+
+        auto reply = player.ponder(game);
+        REQUIRE(reply.has_value());
+        REQUIRE(player.pondering());
+        REQUIRE(reply->piece == Piece::White);
+        REQUIRE(game.board().legal_moves(Piece::White) >> (reply->row * 8 + reply->column) & 1);
+
+        THEN("the expected reply is a ponder hit with a move as good as a search from scratch") {
+            REQUIRE(game.next_move(reply->piece, reply->row, reply->column) != MoveStatus::Error);
+            auto result = player.search(game);
+
+            REQUIRE(result.ponder_hit);
+            REQUIRE_FALSE(player.pondering());
+            REQUIRE(result.depth == 5);
+
+            auto fresh_options = SearchOptions{.hash_mb = 0, .endgame_empties = 0};
+            SearchPlayer fresh{Piece::Black, SearchLimits{.depth = 5}, fresh_options};
+            auto expected = fresh.search(game);
+            REQUIRE(result.score == expected.score);
+
+            // Moves may differ between equal scores, so the move played is scored by searching the reply instead
+            REQUIRE(game.next_move(result.move.piece, result.move.row, result.move.column) != MoveStatus::Error);
+            SearchPlayer reply_search{Piece::White, SearchLimits{.depth = 4}, fresh_options};
+            REQUIRE(-reply_search.search(game).score == expected.score);
+        }
+
+        THEN("another reply is a miss and is searched normally") {
+            auto expected = std::uint64_t{1} << (reply->row * 8 + reply->column);
+            auto moves = game.board().legal_moves(Piece::White) & ~expected;
+            REQUIRE(moves != 0);
+
+            auto square = std::countr_zero(moves);
+            REQUIRE(game.next_move(Piece::White, square / 8, square % 8) != MoveStatus::Error);
+            auto result = player.search(game);
+
+            REQUIRE_FALSE(result.ponder_hit);
+            REQUIRE_FALSE(player.pondering());
+            REQUIRE(game.board().legal_moves(Piece::Black) >> (result.move.row * 8 + result.move.column) & 1);
+        }
+
+        THEN("pondering can be stopped") {
+            player.stop_pondering();
+            REQUIRE_FALSE(player.pondering());
+        }
+    }
+
+    GIVEN("a time limited search player pondering") {
+        Game game;
+        auto limits = SearchLimits{.depth = 60, .time = std::chrono::milliseconds{50}};
+        auto player = std::make_unique<SearchPlayer>(
+            Piece::Black, limits, SearchOptions{.hash_mb = 4, .endgame_empties = 0}
+        );
+        auto move = player->get_next_move(game);
+        REQUIRE(game.next_move(move.piece, move.row, move.column) != MoveStatus::Error);
+
+        auto reply = player->ponder(game);
+        REQUIRE(reply.has_value());
+
+        THEN("a ponder hit stops within the time limit counted from the hit") {
+            std::this_thread::sleep_for(std::chrono::milliseconds{100});
+            REQUIRE(game.next_move(reply->piece, reply->row, reply->column) != MoveStatus::Error);
+            auto result = player->search(game);
+
+            REQUIRE(result.ponder_hit);
+            REQUIRE(result.elapsed < std::chrono::milliseconds{1000});
+            REQUIRE(game.board().legal_moves(Piece::Black) >> (result.move.row * 8 + result.move.column) & 1);
+        }
+
+        THEN("destroying the player stops an unbounded ponder") {
+            std::this_thread::sleep_for(std::chrono::milliseconds{100});
+            REQUIRE(player->pondering());
+
+            auto start = std::chrono::steady_clock::now();
+            player.reset();
+
+            REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds{1000});
+        }
+    }
+
+    GIVEN("a white search player pondering") {
+        Game game;
+        REQUIRE(play_moves(game, "f5"));
+        SearchPlayer player{Piece::White, SearchLimits{.depth = 4}, SearchOptions{.hash_mb = 4, .endgame_empties = 0}};
+        auto move = player.get_next_move(game);
+        REQUIRE(game.next_move(move.piece, move.row, move.column) != MoveStatus::Error);
+
+        auto reply = player.ponder(game);
+        REQUIRE(reply.has_value());
+
+        THEN("the pondered discs with the other side to move are a miss") {
+            auto board = game.board();
+            board.make(*reply);
+            Game other_turn{board};
+            REQUIRE(other_turn.current_turn() == Piece::Black);
+            REQUIRE(board.legal_moves(Piece::Black) != 0);
+
+            auto result = player.search(other_turn);
+
+            REQUIRE_FALSE(result.ponder_hit);
+            REQUIRE_FALSE(player.pondering());
+        }
+    }
+
+    GIVEN("a player without a transposition table") {
+        Game game;
+        SearchPlayer player{Piece::Black, SearchLimits{.depth = 3}, SearchOptions{.hash_mb = 0}};
+        auto move = player.get_next_move(game);
+        REQUIRE(game.next_move(move.piece, move.row, move.column) != MoveStatus::Error);
+
+        THEN("there is no expected reply to ponder on") {
+            REQUIRE_FALSE(player.ponder(game).has_value());
+            REQUIRE_FALSE(player.pondering());
+        }
+    }
+}
+
+SCENARIO("Transposition table", "[Search]") {
+    GIVEN("an empty table") {
+        TranspositionTable table{1};
+        TranspositionEntry entry;
+
+        THEN("table size is the requested size") {
+            REQUIRE(table.size_bytes() == 1024 * 1024);
+        }
+
+        THEN("probe misses") {
+            REQUIRE_FALSE(table.probe(Board{}.hash(), entry));
+        }
+
+        WHEN("an entry is stored") {
+            auto key = Board{}.hash();
+            REQUIRE_FALSE(table.store(key, TranspositionEntry{
+                .score = -37, .depth = 9, .bound = Bound::Lower, .best_square = 19
+            }));
+
+            THEN("probe finds the same entry") {
+                REQUIRE(table.probe(key, entry));
+                REQUIRE(entry.score == -37);
+                REQUIRE(entry.depth == 9);
+                REQUIRE(entry.bound == Bound::Lower);
+                REQUIRE(entry.best_square == 19);
+            }
+
+            THEN("a key in the same bucket misses") {
+                REQUIRE_FALSE(table.probe(key ^ (std::uint64_t{1} << 63), entry));
+            }
+
+            THEN("storing the same key again is not an overwrite") {
+                REQUIRE_FALSE(table.store(key, TranspositionEntry{.score = 1, .depth = 10, .bound = Bound::Exact}));
+                REQUIRE(table.probe(key, entry));
+                REQUIRE(entry.best_square == -1);
+            }
+
+            THEN("filling the bucket with other keys overwrites a shallower entry") {
+                auto overwrites = 0;
+
+                for (std::uint64_t i = 1; i <= 4; i++) {
+                    auto other = TranspositionEntry{.score = 0, .depth = 1, .bound = Bound::Upper};
+                    overwrites += table.store(key ^ (i << 60), other);
+                }
+
+                REQUIRE(overwrites == 1);
+                REQUIRE(table.probe(key, entry));
+                REQUIRE_FALSE(table.probe(key ^ (std::uint64_t{1} << 60), entry));
+            }
+        }
+    }
+
+    GIVEN("a game near the end") {
+        Game game;
+        SearchPlayer black{Piece::Black, SearchLimits{.depth = 2}};
+        SearchPlayer white{Piece::White, SearchLimits{.depth = 2}};
+
+        while (game.move_count() < 48 && game.status() == GameStatus::Continue) {
+            auto move = (game.current_turn() == Piece::Black ? black : white).get_next_move(game);
+            REQUIRE(game.next_move(move.piece, move.row, move.column) != MoveStatus::Error);
+        }
+
+        THEN("searching to the end gives the same score with and without a table") {
+            SearchPlayer with_table{
+                game.current_turn(), SearchLimits{.depth = 60}, SearchOptions{.endgame_empties = 0}
+            };
+            SearchPlayer without_table{
+                game.current_turn(), SearchLimits{.depth = 60}, SearchOptions{.hash_mb = 0, .endgame_empties = 0}
+            };
+
+            auto result = with_table.search(game);
+            REQUIRE(result.score == without_table.search(game).score);
+
+            auto stats = with_table.transposition_table()->stats();
+            REQUIRE(stats.hits > 0);
+            REQUIRE(stats.stores > 0);
+            REQUIRE(result.nodes < without_table.search(game).nodes);
+        }
+    }
+}
+
+int exact_difference(Board &board, Piece piece) {
+    auto score = minimax(board, piece, 64);
+    return score > 0 ? score - win_score : score < 0 ? score + win_score : 0;
+}
+
+SCENARIO("Endgame solver", "[Endgame]") {
+    GIVEN("positions from random games with few empty cells") {
+        std::mt19937_64 random{11};
+        std::vector<Game> games;
+
+        for (int i = 0; i < 30; i++) {
+            Game game;
+            auto discs = 60 - i % 7;
+
+            while (game.status() == GameStatus::Continue &&
+                   game.board().score(Piece::Black) + game.board().score(Piece::White) < discs) {
+                auto moves = game.board().legal_moves(game.current_turn());
+
+                for (auto skip = random() % std::popcount(moves); skip > 0; skip--) {
+                    moves &= moves - 1;
+                }
+
+                auto square = std::countr_zero(moves);
+                REQUIRE(game.next_move(game.current_turn(), square / 8, square % 8) != MoveStatus::Error);
+            }
+
+            if (game.status() == GameStatus::Continue) {
+                games.push_back(game);
+            }
+        }
+
+        REQUIRE(games.size() > 20);
+
+        THEN("exact score is the minimax disc difference and the move reaches it") {
+            for (const auto &game: games) {
+                auto board = game.board();
+                auto expected = exact_difference(board, game.current_turn());
+                auto result = solve_endgame(game.board(), game.current_turn());
+
+                REQUIRE(result.score == expected);
+
+                REQUIRE(board.put(result.move.piece, result.move.row, result.move.column) == Result::Ok);
+                REQUIRE(-exact_difference(board, opponent(game.current_turn())) == expected);
+            }
+        }
+
+        THEN("win/loss/draw mode gives the sign of the exact score") {
+            for (const auto &game: games) {
+                auto exact = solve_endgame(game.board(), game.current_turn());
+                auto outcome = solve_endgame(game.board(), game.current_turn(), SolveMode::WinLossDraw);
+
+                REQUIRE(outcome.score == (exact.score > 0) - (exact.score < 0));
+                REQUIRE(outcome.nodes <= exact.nodes);
+            }
+        }
+
+        THEN("a table kept across solves and modes gives the same scores") {
+            TranspositionTable table{1};
+
+            for (const auto &game: games) {
+                auto fresh = solve_endgame(game.board(), game.current_turn());
+                auto outcome = solve_endgame(game.board(), game.current_turn(), table, SolveMode::WinLossDraw);
+                auto kept = solve_endgame(game.board(), game.current_turn(), table);
+
+                REQUIRE(kept.score == fresh.score);
+                REQUIRE(outcome.score == (fresh.score > 0) - (fresh.score < 0));
+            }
+        }
+
+        THEN("search player plays the solved move") {
+            for (const auto &game: games) {
+                SearchPlayer player{game.current_turn(), SearchLimits{}, SearchOptions{.endgame_empties = 10}};
+                auto result = player.search(game);
+                auto board = game.board();
+                auto expected = exact_difference(board, game.current_turn());
+
+                REQUIRE(board.put(result.move.piece, result.move.row, result.move.column) == Result::Ok);
+                REQUIRE(-exact_difference(board, opponent(game.current_turn())) == expected);
+            }
+        }
+    }
+}
+
+
+Board random_position(std::mt19937_64 &random, int discs) {
+    Game game;
+
+    while (game.status() == GameStatus::Continue &&
+           game.board().score(Piece::Black) + game.board().score(Piece::White) < discs) {
+        auto moves = game.board().legal_moves(game.current_turn());
+
+        for (auto skip = random() % std::popcount(moves); skip > 0; skip--) {
+            moves &= moves - 1;
+        }
+
+        auto square = std::countr_zero(moves);
+        game.next_move(game.current_turn(), square / 8, square % 8);
+    }
+
+    return game.board();
+}
+
+// Symmetries 0-7 as combinations of transposing and flipping rows and columns
+Board symmetric_board(const Board &board, int symmetry) {
+    std::vector<std::vector<Cell>> cells(8, std::vector<Cell>(8));
+
+    for (int row = 0; row < 8; row++) {
+        for (int column = 0; column < 8; column++) {
+            auto from_row = symmetry & 1 ? column : row;
+            auto from_column = symmetry & 1 ? row : column;
+            from_row = symmetry & 2 ? 7 - from_row : from_row;
+            from_column = symmetry & 4 ? 7 - from_column : from_column;
+            cells[row][column] = board.get(from_row, from_column);
+        }
+    }
+
+    return Board{cells};
+}
+
+SCENARIO("Pattern evaluation", "[Eval]") {
+    GIVEN("positions from random games") {
+        std::mt19937_64 random{13};
+        std::vector<Board> boards;
+
+        for (int discs = 4; discs <= 64; discs += 2) {
+            boards.push_back(random_position(random, discs));
+        }
+
+        THEN("every cell belongs to some feature") {
+            std::uint64_t covered = 0;
+
+            for (const auto &feature: features()) {
+                REQUIRE(feature.size == pattern_size(feature.pattern));
+
+                for (int digit = 0; digit < feature.size; digit++) {
+                    covered |= std::uint64_t{1} << feature.squares[digit];
+                }
+            }
+
+            REQUIRE(covered == ~std::uint64_t{0});
+        }
+
+        THEN("bitboard feature indices match indices read cell by cell") {
+            for (const auto &board: boards) {
+                auto indices = feature_indices(board);
+
+                for (int i = 0; i < feature_count; i++) {
+                    const auto &feature = features()[i];
+                    std::uint32_t expected = 0;
+
+                    for (int digit = feature.size - 1; digit >= 0; digit--) {
+                        auto square = feature.squares[digit];
+                        expected = expected * 3 + static_cast<std::uint32_t>(board.get(square / 8, square % 8));
+                    }
+
+                    REQUIRE(indices[i] == expected);
+                }
+            }
+        }
+
+        THEN("incremental indices follow make and unmake") {
+            for (const auto &start: boards) {
+                auto board = start;
+                EvalState state{board};
+                std::vector<UndoInfo> undos;
+                auto piece = Piece::Black;
+
+                for (int ply = 0; ply < 12; ply++) {
+                    auto moves = board.legal_moves(piece);
+
+                    if (moves == 0) {
+                        piece = opponent(piece);
+                        continue;
+                    }
+
+                    auto square = std::countr_zero(moves);
+                    auto undo = board.make(Move{.piece = piece, .row = square / 8, .column = square % 8});
+                    state.update(undo);
+                    undos.push_back(undo);
+                    piece = opponent(piece);
+
+                    REQUIRE(state.indices() == feature_indices(board));
+                    REQUIRE(state.phase() == phase(board));
+                }
+
+                state.update(board.make(Move{.piece = piece, .row = -1, .column = -1}));
+                REQUIRE(state.indices() == feature_indices(board));
+
+                for (auto undo = undos.rbegin(); undo != undos.rend(); ++undo) {
+                    board.unmake(*undo);
+                    state.restore(*undo);
+                }
+
+                REQUIRE(state.indices() == feature_indices(start));
+                REQUIRE(default_evaluator().evaluate(state, Piece::White) ==
+                        default_evaluator().evaluate(start, Piece::White));
+            }
+        }
+
+        THEN("symmetric positions evaluate the same") {
+            const auto &evaluator = default_evaluator();
+
+            for (const auto &board: boards) {
+                auto score = evaluator.evaluate(board, Piece::Black);
+
+                for (int symmetry = 1; symmetry < 8; symmetry++) {
+                    REQUIRE(evaluator.evaluate(symmetric_board(board, symmetry), Piece::Black) == score);
+                }
+
+                REQUIRE(evaluator.evaluate(board, Piece::White) == -score);
+                REQUIRE(std::abs(score) <= 64 * eval_scale);
+            }
+        }
+
+        THEN("a corner is worth more than the cell next to it") {
+            auto with_corner = std::vector<std::vector<Cell>>(8, std::vector<Cell>(8, Cell::Empty));
+            auto with_x_square = with_corner;
+            with_corner[0][0] = Cell::Black;
+            with_x_square[1][1] = Cell::Black;
+            with_corner[7][7] = with_x_square[7][7] = Cell::White;
+
+            const auto &evaluator = default_evaluator();
+            REQUIRE(evaluator.evaluate(Board{with_corner}, Piece::Black) >
+                    evaluator.evaluate(Board{with_x_square}, Piece::Black));
+        }
+    }
+}
+
+
+SCENARIO("Training files", "[Eval]") {
+    auto directory = std::filesystem::temp_directory_path();
+
+    GIVEN("labelled positions written to a file") {
+        auto path = (directory / "reversi_test_positions.bin").string();
+        std::mt19937_64 random{17};
+        std::vector<LabelledPosition> written;
+
+        {
+            PositionWriter writer{path};
+
+            for (int discs = 4; discs <= 64; discs++) {
+                auto board = random_position(random, discs);
+                auto score = static_cast<int>(random() % 129) - 64;
+
+                writer.write(board, score);
+                written.push_back(LabelledPosition{
+                    .black = board.discs(Piece::Black),
+                    .white = board.discs(Piece::White),
+                    .score = static_cast<std::int8_t>(score),
+                });
+            }
+
+            REQUIRE(writer.good());
+        }
+
+        THEN("reading in batches gives them back in order, twice after a rewind") {
+            PositionReader reader{path};
+            std::vector<LabelledPosition> batch;
+
+            for (int pass = 0; pass < 2; pass++) {
+                std::vector<LabelledPosition> read;
+
+                while (reader.read(batch, 7) != 0) {
+                    read.insert(read.end(), batch.begin(), batch.end());
+                }
+
+                REQUIRE(read.size() == written.size());
+
+                for (std::size_t i = 0; i < read.size(); i++) {
+                    REQUIRE(read[i].black == written[i].black);
+                    REQUIRE(read[i].white == written[i].white);
+                    REQUIRE(read[i].score == written[i].score);
+                }
+
+                reader.rewind();
+            }
+        }
+
+        THEN("it is not a weight file") {
+            REQUIRE_THROWS_AS(PatternEvaluator{path}, std::runtime_error);
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    GIVEN("weights written to a file") {
+        auto path = (directory / "reversi_test_weights.bin").string();
+        std::vector<std::int16_t> weights(weight_count());
+
+        for (std::size_t i = 0; i < weights.size(); i++) {
+            weights[i] = static_cast<std::int16_t>(i % 201) - 100;
+        }
+
+        REQUIRE(write_weights(path, weights));
+
+        THEN("the mapped evaluator reads the same weights") {
+            PatternEvaluator evaluator{path};
+            auto board = Board{};
+            auto indices = feature_indices(board);
+            int expected = 0;
+
+            for (int i = 0; i < feature_count; i++) {
+                expected += weights[weight_offset(phase(board), i) + indices[i]];
+            }
+
+            REQUIRE(std::equal(weights.begin(), weights.end(), evaluator.weights().begin()));
+            REQUIRE(evaluator.evaluate(board, Piece::Black) == std::clamp(expected, -64 * eval_scale, 64 * eval_scale));
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    THEN("a missing weight file throws") {
+        REQUIRE_THROWS_AS(PatternEvaluator{(directory / "reversi_test_missing.bin").string()}, std::runtime_error);
+    }
+}
+
+
+SCENARIO("Game records", "[Record]") {
+    auto path = (std::filesystem::temp_directory_path() / "reversi_test_games.bin").string();
+
+    GIVEN("random games written as records") {
+        std::mt19937_64 random{19};
+        std::vector<GameRecord> written;
+        std::vector<Board> final_boards;
+
+        {
+            GameRecordWriter writer{path};
+
+            for (int i = 0; i < 25; i++) {
+                Game game;
+                GameRecord record{.header = {.source = GameSource::SelfPlay, .black_player = 7, .white_player = 9}};
+
+                while (game.status() == GameStatus::Continue && game.move_count() < 20 + i * 2) {
+                    auto moves = game.board().legal_moves(game.current_turn());
+
+                    for (auto skip = random() % std::popcount(moves); skip > 0; skip--) {
+                        moves &= moves - 1;
+                    }
+
+                    auto square = std::countr_zero(moves);
+                    auto move = Move{.piece = game.current_turn(), .row = square / 8, .column = square % 8};
+                    REQUIRE(game.next_move(move.piece, move.row, move.column) != MoveStatus::Error);
+                    record.add(move);
+                }
+
+                record.finish(game.board());
+                writer.write(record);
+                written.push_back(record);
+                final_boards.push_back(game.board());
+            }
+
+            REQUIRE(writer.good());
+        }
+
+        THEN("the reader gives back every header and move") {
+            GameRecordReader reader{path};
+            std::size_t count = 0;
+
+            for (const auto &record: reader) {
+                REQUIRE(count < written.size());
+                const auto &expected = written[count];
+
+                REQUIRE(record.header.move_count == expected.moves.size());
+                REQUIRE(record.header.black_score == expected.header.black_score);
+                REQUIRE(record.header.source == GameSource::SelfPlay);
+                REQUIRE(record.header.black_player == 7);
+                REQUIRE(record.header.white_player == 9);
+                REQUIRE(std::vector<std::uint8_t>(record.moves.begin(), record.moves.end()) == expected.moves);
+
+                count++;
+            }
+
+            REQUIRE(count == written.size());
+        }
+
+        THEN("replaying a record reaches the final board") {
+            GameRecordReader reader{path};
+            std::size_t i = 0;
+
+            for (const auto &record: reader) {
+                Game game;
+                REQUIRE(play_record(game, record.moves));
+                REQUIRE(game.board() == final_boards[i++]);
+            }
+        }
+
+        WHEN("the file is cut inside the last record") {
+            std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+
+            THEN("iteration stops before it") {
+                GameRecordReader reader{path};
+                auto count = std::distance(reader.begin(), reader.end());
+                REQUIRE(count == static_cast<std::ptrdiff_t>(written.size()) - 1);
+            }
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    THEN("other files are rejected") {
+        std::ofstream{path} << "not a game file";
+        REQUIRE_THROWS_AS(GameRecordReader{path}, std::runtime_error);
+        std::filesystem::remove(path);
+    }
+
+    THEN("the final score counts the empty cells for the winner") {
+        REQUIRE(final_black_score(40, 20) == 24);
+        REQUIRE(final_black_score(13, 0) == 64);
+        REQUIRE(final_black_score(20, 40) == -24);
+        REQUIRE(final_black_score(30, 30) == 0);
+    }
+}
+
+
+// A random finished game and whether the opponent had to pass after each move
+struct PlayedMoves {
+    std::vector<Move> moves{};
+    std::vector<bool> pass_after{};
+    Board final_board{};
+};
+
+PlayedMoves random_game(std::mt19937_64 &random) {
+    PlayedMoves played;
+    Game game;
+
+    while (game.status() == GameStatus::Continue) {
+        auto moves = game.board().legal_moves(game.current_turn());
+
+        for (auto skip = random() % std::popcount(moves); skip > 0; skip--) {
+            moves &= moves - 1;
+        }
+
+        auto square = std::countr_zero(moves);
+        auto move = Move{.piece = game.current_turn(), .row = square / 8, .column = square % 8};
+        auto status = game.next_move(move.piece, move.row, move.column);
+        played.moves.push_back(move);
+        played.pass_after.push_back(status == MoveStatus::ContinueWithSkip);
+    }
+
+    played.final_board = game.board();
+    return played;
+}
+
+std::vector<std::byte> wthor_game(const PlayedMoves &played) {
+    std::vector<std::byte> bytes(wthor_game_size);
+    auto black = played.final_board.score(Piece::Black);
+    auto white = played.final_board.score(Piece::White);
+    auto empties = 64 - black - white;
+
+    bytes[2] = std::byte{3};
+    bytes[4] = std::byte{5};
+    bytes[6] = std::byte(black > white ? black + empties : black < white ? black : black + empties / 2);
+
+    for (std::size_t i = 0; i < played.moves.size(); i++) {
+        bytes[8 + i] = std::byte(10 * (played.moves[i].row + 1) + played.moves[i].column + 1);
+    }
+
+    return bytes;
+}
+
+std::string ggf_game(const PlayedMoves &played, std::string_view type = "8") {
+    std::string text = "(;GM[Othello]PC[NOS]PB[one]PW[two]TY[";
+    text += type;
+    text += "]BO[8 -------- -------- -------- ---O*--- ---*O--- -------- -------- -------- *]";
+
+    for (std::size_t i = 0; i < played.moves.size(); i++) {
+        const auto &move = played.moves[i];
+        text += move.piece == Piece::Black ? "B[" : "W[";
+        text += static_cast<char>('a' + move.column);
+        text += static_cast<char>('1' + move.row);
+        text += "//0.01]";
+
+        if (played.pass_after[i]) {
+            text += move.piece == Piece::Black ? "W[PA]" : "B[PA]";
+        }
+    }
+
+    auto difference = played.final_board.score(Piece::Black) - played.final_board.score(Piece::White);
+    text += "RE[" + std::string{difference >= 0 ? "+" : ""} + std::to_string(difference) + ".000];)";
+    return text;
+}
+
+SCENARIO("Import game databases", "[Import]") {
+    GIVEN("random finished games") {
+        std::mt19937_64 random{23};
+        std::vector<PlayedMoves> games;
+
+        for (int i = 0; i < 20; i++) {
+            games.push_back(random_game(random));
+        }
+
+        THEN("WTHOR games import with their moves, players and final score") {
+            for (const auto &played: games) {
+                GameRecord record;
+                REQUIRE(import_wthor_game(wthor_game(played), record) == ImportError::None);
+
+                REQUIRE(record.header.source == GameSource::Wthor);
+                REQUIRE(record.header.black_player == 3);
+                REQUIRE(record.header.white_player == 5);
+                REQUIRE(record.moves.size() == played.moves.size());
+
+                // Empty cells are counted for the winner, like the disc count the file records
+                auto black = std::to_integer<int>(wthor_game(played)[6]);
+                REQUIRE(record.header.black_score == 2 * black - 64);
+
+                Game game;
+                REQUIRE(play_record(game, record.moves));
+                REQUIRE(game.board() == played.final_board);
+            }
+        }
+
+        THEN("WTHOR games with an illegal move or a wrong score are rejected") {
+            for (const auto &played: games) {
+                GameRecord record;
+                auto bytes = wthor_game(played);
+
+                auto wrong_score = bytes;
+                wrong_score[6] = std::byte(std::to_integer<int>(bytes[6]) ^ 1);
+                REQUIRE(import_wthor_game(wrong_score, record) == ImportError::ScoreMismatch);
+
+                auto illegal = bytes;
+                illegal[9] = bytes[8];
+                REQUIRE(import_wthor_game(illegal, record) == ImportError::IllegalMove);
+            }
+        }
+
+        THEN("a WTHOR file header is read") {
+            std::vector<std::byte> header(wthor_header_size);
+            header[4] = std::byte{0x34};
+            header[5] = std::byte{0x12};
+            header[10] = std::byte{0xd0};
+            header[11] = std::byte{0x07};
+            header[12] = std::byte{8};
+
+            WthorFileHeader parsed;
+            REQUIRE(parse_wthor_header(header, parsed));
+            REQUIRE(parsed.games == 0x1234);
+            REQUIRE(parsed.year == 2000);
+
+            header[12] = std::byte{10};
+            REQUIRE_FALSE(parse_wthor_header(header, parsed));
+        }
+
+        THEN("GGF games import from a file holding several of them") {
+            std::string text;
+
+            for (const auto &played: games) {
+                text += ggf_game(played) + "\n";
+            }
+
+            auto split = split_ggf_games(text);
+            REQUIRE(split.size() == games.size());
+
+            for (std::size_t i = 0; i < games.size(); i++) {
+                GameRecord record;
+                REQUIRE(import_ggf_game(split[i], record) == ImportError::None);
+
+                Game game;
+                REQUIRE(play_record(game, record.moves));
+                REQUIRE(game.board() == games[i].final_board);
+
+                GameRecord wthor;
+                REQUIRE(import_wthor_game(wthor_game(games[i]), wthor) == ImportError::None);
+                REQUIRE(record.header.black_score == wthor.header.black_score);
+            }
+        }
+
+        THEN("GGF variants are not imported") {
+            GameRecord record;
+            REQUIRE(import_ggf_game(ggf_game(games[0], "8r"), record) == ImportError::Unsupported);
+        }
+
+        THEN("positions of a record are the boards before each move") {
+            GameRecord record;
+            REQUIRE(import_wthor_game(wthor_game(games[0]), record) == ImportError::None);
+
+            std::vector<LabelledPosition> positions;
+            record_positions(record, positions);
+            REQUIRE(positions.size() == record.moves.size());
+
+            Game game;
+
+            for (std::size_t i = 0; i < positions.size(); i++) {
+                REQUIRE(positions[i].black == game.board().discs(Piece::Black));
+                REQUIRE(positions[i].white == game.board().discs(Piece::White));
+                REQUIRE(positions[i].score == record.header.black_score);
+                REQUIRE(play_record(game, std::span{record.moves}.subspan(i, 1)));
+            }
+        }
+    }
+}
+
+SCENARIO("Board symmetries", "[Board]") {
+    GIVEN("positions from random games") {
+        std::mt19937_64 random{22};
+        std::vector<Board> boards;
+
+        for (int game = 0; game < 50; game++) {
+            boards.push_back(random_position(random, 8 + game % 50));
+        }
+
+        THEN("transforms match moving the cells one by one") {
+            for (const auto &board: boards) {
+                for (int i = 0; i < symmetry_count; i++) {
+                    auto symmetry = static_cast<Symmetry>(i);
+                    auto transformed = board.transformed(symmetry);
+
+                    REQUIRE(transformed == symmetric_board(board, static_cast<int>(inverse(symmetry))));
+                    REQUIRE(transformed.hash() == symmetric_board(board, static_cast<int>(inverse(symmetry))).hash());
+                    REQUIRE(transformed.transformed(inverse(symmetry)) == board);
+                }
+
+                REQUIRE(board.transformed(Symmetry::RotateLeft).transformed(Symmetry::RotateLeft) ==
+                        board.transformed(Symmetry::Rotate180));
+                REQUIRE(board.transformed(Symmetry::RotateRight).transformed(Symmetry::RotateLeft) == board);
+            }
+        }
+
+        THEN("every symmetric version has the same canonical board") {
+            for (const auto &board: boards) {
+                auto canonical = board.canonical();
+
+                REQUIRE(board.transformed(canonical.symmetry) == canonical.board);
+
+                for (int i = 0; i < symmetry_count; i++) {
+                    auto symmetric = board.transformed(static_cast<Symmetry>(i)).canonical();
+
+                    REQUIRE(symmetric.board == canonical.board);
+                    REQUIRE(symmetric.board.hash() == canonical.board.hash());
+                }
+            }
+        }
+
+        THEN("moves map to the same moves of the transformed board") {
+            for (const auto &board: boards) {
+                for (int i = 0; i < symmetry_count; i++) {
+                    auto symmetry = static_cast<Symmetry>(i);
+
+                    for (auto moves = board.legal_moves(Piece::Black); moves != 0; moves &= moves - 1) {
+                        auto square = std::countr_zero(moves);
+                        auto move = Move{.piece = Piece::Black, .row = square / 8, .column = square % 8};
+                        auto transformed_move = transform(move, symmetry);
+                        auto after = board;
+                        auto transformed_after = board.transformed(symmetry);
+
+                        REQUIRE(after.make(move).flipped != 0);
+                        REQUIRE(transformed_after.make(transformed_move).flipped != 0);
+                        REQUIRE(after.transformed(symmetry) == transformed_after);
+
+                        auto back = transform(transformed_move, inverse(symmetry));
+                        REQUIRE(back.row == move.row);
+                        REQUIRE(back.column == move.column);
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Opening book", "[Book]") {
+    auto path = (std::filesystem::temp_directory_path() / "reversi_test_book.bin").string();
+
+    GIVEN("positions from random games") {
+        std::mt19937_64 random{20};
+        std::vector<Board> boards;
+
+        for (int i = 0; i < 50; i++) {
+            boards.push_back(random_position(random, 8 + i % 40));
+        }
+
+        THEN("all symmetric versions share a key, which depends on the side to move") {
+            for (const auto &board: boards) {
+                for (int symmetry = 1; symmetry < symmetry_count; symmetry++) {
+                    auto symmetric = board.transformed(static_cast<Symmetry>(symmetry));
+
+                    REQUIRE(book_key(symmetric, Piece::Black) == book_key(board, Piece::Black));
+                    REQUIRE(book_key(symmetric, Piece::White) == book_key(board, Piece::White));
+                }
+
+                REQUIRE(book_key(board, Piece::Black) != book_key(board, Piece::White));
+            }
+        }
+    }
+
+    GIVEN("a book with a move of each position on its canonical board") {
+        std::mt19937_64 random{21};
+        std::vector<Board> boards;
+        std::vector<BookEntry> entries;
+
+        while (boards.size() < 20) {
+            auto board = random_position(random, 10 + static_cast<int>(boards.size()));
+
+            if (board.legal_moves(Piece::Black) == 0) {
+                continue;
+            }
+
+            auto square = std::countr_zero(board.canonical().board.legal_moves(Piece::Black));
+
+            boards.push_back(board);
+            entries.push_back(BookEntry{
+                .key = book_key(board, Piece::Black),
+                .score = static_cast<std::int16_t>(boards.size()),
+                .square = static_cast<std::uint8_t>(square),
+                .depth = 4,
+                .games = 1,
+            });
+        }
+
+        REQUIRE(write_book(path, entries));
+        OpeningBook book{path};
+        REQUIRE(book.entries().size() == entries.size());
+
+        THEN("every symmetric version finds the same move turned to its own orientation") {
+            for (std::size_t i = 0; i < boards.size(); i++) {
+                auto moved = boards[i];
+                auto found = book.probe(moved, Piece::Black);
+
+                REQUIRE(found.has_value());
+                REQUIRE(found->score == static_cast<int>(i + 1));
+                REQUIRE(moved.make(found->move).flipped != 0);
+                auto key = book_key(moved, Piece::White);
+
+                for (int symmetry = 1; symmetry < 8; symmetry++) {
+                    auto symmetric = symmetric_board(boards[i], symmetry);
+                    auto symmetric_found = book.probe(symmetric, Piece::Black);
+
+                    REQUIRE(symmetric_found.has_value());
+                    REQUIRE(symmetric.make(symmetric_found->move).flipped != 0);
+                    REQUIRE(book_key(symmetric, Piece::White) == key);
+                }
+            }
+        }
+
+        THEN("positions not in the book and the other side to move are missed") {
+            REQUIRE_FALSE(book.probe(boards[0], Piece::White).has_value());
+            REQUIRE_FALSE(book.probe(random_position(random, 50), Piece::Black).has_value());
+        }
+
+        THEN("a search player plays the book move without searching") {
+            auto options = SearchOptions{.hash_mb = 0, .book = std::make_shared<const OpeningBook>(path)};
+            SearchPlayer player{Piece::Black, SearchLimits{.depth = 4}, options};
+            auto result = player.search(Game{boards[3]});
+            auto expected = book.probe(boards[3], Piece::Black);
+
+            REQUIRE(result.nodes == 0);
+            REQUIRE(result.depth == 4);
+            REQUIRE(result.move.row == expected->move.row);
+            REQUIRE(result.move.column == expected->move.column);
+        }
+    }
+
+    GIVEN("a file that is not a book") {
+        {
+            std::ofstream file{path, std::ios::binary | std::ios::trunc};
+            file << "not a book at all";
+        }
+
+        THEN("opening it throws") {
+            REQUIRE_THROWS_AS(OpeningBook{path}, std::runtime_error);
+        }
+    }
+
+    GIVEN("a book whose entry count overflows to the size of the file") {
+        {
+            // 16 bytes of entries for 2^60 + 1 entries once multiplied by the entry size
+            std::uint64_t count = (std::uint64_t{1} << 60) + 1;
+            BookEntry entry{};
+            std::ofstream file{path, std::ios::binary | std::ios::trunc};
+            file.write("RVBOOK\0\2", 8);
+            file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+            file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        }
+
+        THEN("opening it throws") {
+            REQUIRE_THROWS_AS(OpeningBook{path}, std::runtime_error);
+        }
+    }
+}
+
+SCENARIO("MCTS player", "[Mcts]") {
+    GIVEN("new Game") {
+        Game game;
+
+        THEN("MCTS players with either rollout policy move legally until game over") {
+            auto limits = MctsLimits{.playouts = 200};
+            MctsPlayer player1{Piece::Black, limits, MctsOptions{.rollout = RolloutPolicy::Random}};
+            MctsPlayer player2{Piece::White, limits, MctsOptions{.rollout = RolloutPolicy::Greedy}};
+
+            while (game.status() == GameStatus::Continue) {
+                const auto &player = game.current_turn() == Piece::Black ? player1 : player2;
+                auto move = player.get_next_move(game);
+
+                REQUIRE(move.piece == player.piece());
+                REQUIRE(game.next_move(move.piece, move.row, move.column) != MoveStatus::Error);
+            }
+        }
+
+        THEN("threads share the playout limit and the tree") {
+            MctsPlayer player{Piece::Black, MctsLimits{.playouts = 2000}, MctsOptions{.threads = 4}};
+            auto result = player.search(game);
+
+            REQUIRE(game.board().legal_moves(Piece::Black) >> (result.move.row * 8 + result.move.column) & 1);
+            REQUIRE(result.playouts >= 2000);
+            REQUIRE(result.playouts < 2000 + 4);
+            REQUIRE(result.nodes > 1);
+            REQUIRE(result.reused_nodes == 0);
+            REQUIRE(result.win_rate > 0);
+            REQUIRE(result.win_rate < 1);
+        }
+
+        THEN("the tree below the reply to the move played is kept for the next search") {
+            MctsPlayer player{Piece::Black, MctsLimits{.playouts = 3000}};
+            auto move = player.get_next_move(game);
+            auto first = player.last_result();
+
+            REQUIRE(game.next_move(move.piece, move.row, move.column) != MoveStatus::Error);
+            auto reply = std::countr_zero(game.board().legal_moves(Piece::White));
+            REQUIRE(game.next_move(Piece::White, reply / 8, reply % 8) != MoveStatus::Error);
+
+            auto second = player.search(game);
+            REQUIRE(second.reused_nodes > 0);
+            REQUIRE(second.reused_nodes < first.nodes);
+            REQUIRE(second.nodes > second.reused_nodes);
+
+            AND_THEN("searching the same position again keeps the whole tree") {
+                REQUIRE(player.search(game).reused_nodes == second.nodes);
+            }
+
+            AND_THEN("a position that can't follow starts a new tree") {
+                REQUIRE(player.search(Game{}).reused_nodes == 0);
+            }
+        }
+
+        THEN("players told not to reuse the tree start every search from nothing") {
+            MctsPlayer player{Piece::Black, MctsLimits{.playouts = 1000}, MctsOptions{.reuse_tree = false}};
+            REQUIRE(player.search(game).reused_nodes == 0);
+            REQUIRE(player.search(game).reused_nodes == 0);
+        }
+
+        THEN("a small tree stops growing when full and still finds a legal move") {
+            MctsPlayer player{Piece::Black, MctsLimits{.playouts = 20000}, MctsOptions{.tree_mb = 0}};
+            auto result = player.search(game);
+
+            REQUIRE(game.board().legal_moves(Piece::Black) >> (result.move.row * 8 + result.move.column) & 1);
+        }
+
+        THEN("a time limit alone stops the search") {
+            MctsPlayer player{Piece::Black, MctsLimits{.playouts = 0, .time = std::chrono::milliseconds{20}}};
+            auto result = player.search(game);
+
+            REQUIRE(result.playouts > 0);
+            REQUIRE(result.elapsed < std::chrono::seconds{1});
+        }
+
+        THEN("searching without any limit is refused") {
+            REQUIRE_THROWS_AS(MctsPlayer(Piece::Black, MctsLimits{.playouts = 0}), std::invalid_argument);
+        }
+    }
+
+    GIVEN("won endgame positions") {
+        std::mt19937_64 random{23};
+        std::vector<Board> boards;
+
+        while (boards.size() < 10) {
+            auto board = random_position(random, 56);
+
+            if (board.legal_moves(Piece::Black) == 0 || solve_endgame(board, Piece::Black).score <= 0) {
+                continue;
+            }
+
+            boards.push_back(board);
+        }
+
+        THEN("the move played keeps the win") {
+            for (auto board: boards) {
+                MctsPlayer player{Piece::Black, MctsLimits{.playouts = 20000}};
+                auto move = player.get_next_move(Game{board});
+
+                REQUIRE(board.make(move).flipped != 0);
+                REQUIRE(solve_endgame(board, Piece::White).score < 0);
+            }
+        }
+    }
+}
+
+SCENARIO("Asynchronous moves", "[Player]") {
+    GIVEN("new Game") {
+        Game game;
+
+        THEN("the greedy CPU gives the same move either way") {
+            CpuPlayer player{Piece::Black};
+            auto move = player.get_next_move_async(game).get();
+            auto expected = player.get_next_move(game);
+
+            REQUIRE(move.row == expected.row);
+            REQUIRE(move.column == expected.column);
+        }
+
+        THEN("a search reports every completed depth and ends with the move of the last one") {
+            SearchPlayer player{Piece::Black, SearchLimits{.depth = 5}, SearchOptions{.endgame_empties = 0}};
+            std::vector<MoveProgress> reports;
+            auto move = player.get_next_move_async(game, {}, [&](const MoveProgress &progress) {
+                reports.push_back(progress);
+            }).get();
+
+            REQUIRE(reports.size() == 5);
+
+            for (std::size_t i = 0; i < reports.size(); i++) {
+                auto square = reports[i].move.row * 8 + reports[i].move.column;
+                REQUIRE(reports[i].depth == static_cast<int>(i + 1));
+                REQUIRE(game.board().legal_moves(Piece::Black) >> square & 1);
+            }
+
+            REQUIRE(move.row == reports.back().move.row);
+            REQUIRE(move.column == reports.back().move.column);
+            REQUIRE(player.last_result().depth == 5);
+        }
+
+        THEN("stopping an unbounded search gives the move of the last completed depth") {
+            SearchPlayer player{Piece::Black, SearchLimits{.depth = 60}, SearchOptions{.endgame_empties = 0}};
+            std::stop_source stop;
+            auto pending = player.get_next_move_async(game, stop.get_token());
+
+            std::this_thread::sleep_for(std::chrono::milliseconds{50});
+            stop.request_stop();
+
+            REQUIRE(pending.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+            auto move = pending.get();
+
+            REQUIRE(game.board().legal_moves(Piece::Black) >> (move.row * 8 + move.column) & 1);
+            REQUIRE(player.last_result().depth >= 1);
+            REQUIRE(player.last_result().depth < 60);
+        }
+
+        THEN("stopping MCTS ends it long before its time limit and reports progress meanwhile") {
+            auto limits = MctsLimits{.playouts = 0, .time = std::chrono::seconds{60}};
+            MctsPlayer player{Piece::Black, limits};
+            std::stop_source stop;
+            // Assertions are not thread-safe, the reports are only counted on the searching thread
+            std::atomic<int> reports{0};
+            std::atomic<int> shallow_reports{0};
+            auto pending = player.get_next_move_async(game, stop.get_token(), [&](const MoveProgress &progress) {
+                reports++;
+                shallow_reports += progress.depth < 1;
+            });
+
+            std::this_thread::sleep_for(std::chrono::milliseconds{200});
+            stop.request_stop();
+
+            REQUIRE(pending.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+            auto move = pending.get();
+
+            REQUIRE(game.board().legal_moves(Piece::Black) >> (move.row * 8 + move.column) & 1);
+            REQUIRE(reports > 0);
+            REQUIRE(shallow_reports == 0);
+        }
+
+        THEN("a game can go on while a search runs on its copy") {
+            SearchPlayer player{Piece::Black, SearchLimits{.depth = 4}};
+            auto pending = player.get_next_move_async(game);
+            auto copy = game;
+
+            REQUIRE(game.next_move(Piece::Black, 2, 3) != MoveStatus::Error);
+
+            auto move = pending.get();
+            REQUIRE(copy.next_move(move.piece, move.row, move.column) != MoveStatus::Error);
+        }
+    }
+
+    GIVEN("a pool of two threads") {
+        ThreadPool pool{2};
+
+        THEN("eight games played on it at once all finish with legal moves") {
+            auto options = SearchOptions{.hash_mb = 1, .endgame_empties = 0};
+            std::vector<Game> games(8);
+            std::vector<std::unique_ptr<Player>> players;
+
+            for (std::size_t i = 0; i < games.size(); i++) {
+                players.push_back(std::make_unique<SearchPlayer>(Piece::Black, SearchLimits{.depth = 2}, options));
+                players.push_back(std::make_unique<SearchPlayer>(Piece::White, SearchLimits{.depth = 1}, options));
+            }
+
+            auto playing = true;
+
+            while (playing) {
+                std::vector<std::future<Move>> pending(games.size());
+
+                for (std::size_t i = 0; i < games.size(); i++) {
+                    if (games[i].status() == GameStatus::Continue) {
+                        auto black = games[i].current_turn() == Piece::Black;
+                        pending[i] = players[i * 2 + (black ? 0 : 1)]->get_next_move_async(games[i], pool);
+                    }
+                }
+
+                playing = false;
+
+                for (std::size_t i = 0; i < games.size(); i++) {
+                    if (pending[i].valid()) {
+                        auto move = pending[i].get();
+                        REQUIRE(games[i].next_move(move.piece, move.row, move.column) != MoveStatus::Error);
+                        playing = playing || games[i].status() == GameStatus::Continue;
+                    }
+                }
+            }
+        }
+
+        THEN("a stop request reaches a search queued on it") {
+            SearchPlayer player{Piece::Black, SearchLimits{.depth = 60}, SearchOptions{.endgame_empties = 0}};
+            std::stop_source stop;
+            auto pending = player.get_next_move_async(Game{}, pool, stop.get_token());
+
+            std::this_thread::sleep_for(std::chrono::milliseconds{50});
+            stop.request_stop();
+
+            REQUIRE(pending.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+            auto move = pending.get();
+            REQUIRE(Game{}.board().legal_moves(Piece::Black) >> (move.row * 8 + move.column) & 1);
+        }
+
+        THEN("a pool needs a thread") {
+            REQUIRE_THROWS_AS(ThreadPool{0}, std::invalid_argument);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#include "thread_pool.h"
+
+#include <stdexcept>
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads < 1) {
+        throw std::invalid_argument("a thread pool needs at least one thread");
+    }
+
+    for (int i = 0; i < threads; i++) {
+        _threads.emplace_back([this] {
+            run();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock{_mutex};
+        _stopping = true;
+    }
+
+    _task_ready.notify_all();
+
+    for (auto &thread: _threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock{_mutex};
+        _tasks.push_back(std::move(task));
+    }
+
+    _task_ready.notify_one();
+}
+
+int ThreadPool::threads() const {
+    return static_cast<int>(_threads.size());
+}
+
+void ThreadPool::run() {
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock lock{_mutex};
+            _task_ready.wait(lock, [this] {
+                return _stopping || !_tasks.empty();
+            });
+
+            // Queued tasks still run after the pool starts stopping
+            if (_tasks.empty()) {
+                return;
+            }
+
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+
+        task();
+    }
+}
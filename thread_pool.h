@@ -0,0 +1,39 @@
+#ifndef REVERSI_THREAD_POOL_H
+#define REVERSI_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// A fixed set of threads running submitted tasks in the order they were submitted. Destroying the pool waits for the
+// tasks already submitted.
+class ThreadPool {
+public:
+    // Throws std::invalid_argument if threads is below 1
+    explicit ThreadPool(int threads);
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool();
+
+    void submit(std::function<void()> task);
+
+    [[nodiscard]] int threads() const;
+
+private:
+    void run();
+
+    std::mutex _mutex;
+    std::condition_variable _task_ready;
+    std::deque<std::function<void()>> _tasks{};
+    bool _stopping{false};
+    std::vector<std::thread> _threads{};
+};
+
+#endif //REVERSI_THREAD_POOL_H
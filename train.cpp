@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eval.h"
+#include "game_record.h"
+#include "positions.h"
+
+// Fits the pattern weights to labelled positions by least squares on the final disc difference. Positions come from
+// position files, or from game record files where every position of a game is labelled with its result. Each epoch
+// streams every file once through a fixed-size batch and takes one gradient step for all weights. A position only
+// touches the weights of its own phase, so each thread owns a set of phases and accumulates their gradients without
+// sharing anything.
+
+struct Options {
+    std::vector<std::string> positions{};
+    std::vector<std::string> games{};
+    std::string output{};
+    // Weight file to start from, the built-in weights if empty
+    std::string initial{};
+    int epochs{20};
+    // Fraction of the average error of a weight's positions applied per epoch, spread over the features
+    double rate{1.0};
+    int threads{static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u))};
+    std::size_t batch{1 << 20};
+};
+
+// Weights seen in fewer positions than this move proportionally less, rare configurations are mostly noise
+constexpr double rare_weight_count = 16;
+
+struct PhaseTotals {
+    std::uint64_t positions{0};
+    double squared_error{0};
+};
+
+class Trainer {
+public:
+    Trainer(Options options, std::vector<float> weights)
+        : _options{std::move(options)},
+          _threads{std::clamp(_options.threads, 1, phase_count)},
+          _weights{std::move(weights)},
+          _gradients(_weights.size()),
+          _counts(_weights.size()) {
+    }
+
+    // Returns false if a file can't be read
+    bool run_epoch() {
+        std::fill(_gradients.begin(), _gradients.end(), 0.0);
+        std::fill(_counts.begin(), _counts.end(), 0);
+        std::fill(std::begin(_totals), std::end(_totals), PhaseTotals{});
+
+        std::vector<LabelledPosition> batch;
+
+        for (const auto &path: _options.positions) {
+            std::unique_ptr<PositionReader> reader;
+
+            try {
+                reader = std::make_unique<PositionReader>(path);
+            } catch (const std::runtime_error &error) {
+                std::cerr << error.what() << std::endl;
+                return false;
+            }
+
+            while (reader->read(batch, _options.batch) != 0) {
+                accumulate(batch);
+            }
+        }
+
+        batch.clear();
+
+        for (const auto &path: _options.games) {
+            std::unique_ptr<GameRecordReader> reader;
+
+            try {
+                reader = std::make_unique<GameRecordReader>(path);
+            } catch (const std::runtime_error &error) {
+                std::cerr << error.what() << std::endl;
+                return false;
+            }
+
+            for (const auto &record: *reader) {
+                add_positions(record, batch);
+
+                if (batch.size() >= _options.batch) {
+                    accumulate(batch);
+                    batch.clear();
+                }
+            }
+        }
+
+        accumulate(batch);
+        step();
+        return true;
+    }
+
+    void print_epoch(int epoch, std::chrono::duration<double> elapsed) const {
+        std::uint64_t positions = 0;
+        double squared_error = 0;
+
+        for (const auto &totals: _totals) {
+            positions += totals.positions;
+            squared_error += totals.squared_error;
+        }
+
+        auto rms = [](double squared_error, std::uint64_t positions) {
+            return positions == 0 ? 0.0 : std::sqrt(squared_error / static_cast<double>(positions)) / eval_scale;
+        };
+
+        std::printf(
+            "epoch %3d  %12llu positions  %8.3f discs rms error  %10.0f positions/s\n", epoch,
+            static_cast<unsigned long long>(positions), rms(squared_error, positions),
+            static_cast<double>(positions) / elapsed.count()
+        );
+
+        std::printf("  by phase:");
+
+        for (const auto &totals: _totals) {
+            std::printf(" %.2f", rms(totals.squared_error, totals.positions));
+        }
+
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+
+    [[nodiscard]] std::vector<std::int16_t> rounded_weights() const {
+        std::vector<std::int16_t> rounded(_weights.size());
+
+        for (std::size_t i = 0; i < _weights.size(); i++) {
+            auto limit = static_cast<float>(std::numeric_limits<std::int16_t>::max());
+            rounded[i] = static_cast<std::int16_t>(std::lround(std::clamp(_weights[i], -limit, limit)));
+        }
+
+        return rounded;
+    }
+
+private:
+    // Every position before a move of the record, stopping at the first illegal move
+    static void add_positions(const GameRecordView &record, std::vector<LabelledPosition> &batch) {
+        Game game;
+
+        for (auto square: record.moves) {
+            batch.push_back(LabelledPosition{
+                .black = game.board().discs(Piece::Black),
+                .white = game.board().discs(Piece::White),
+                .score = record.header.black_score,
+            });
+
+            if (!play_record(game, {&square, 1})) {
+                batch.pop_back();
+                return;
+            }
+        }
+    }
+
+    void accumulate(const std::vector<LabelledPosition> &batch) {
+        std::vector<std::thread> workers;
+
+        for (int thread = 0; thread < _threads; thread++) {
+            workers.emplace_back([&, thread] {
+                for (const auto &position: batch) {
+                    auto position_phase = phase(position.black, position.white);
+
+                    if (position_phase % _threads == thread) {
+                        accumulate(position, position_phase);
+                    }
+                }
+            });
+        }
+
+        for (auto &worker: workers) {
+            worker.join();
+        }
+    }
+
+    // Evaluations are from black's side, the same side as the label
+    void accumulate(const LabelledPosition &position, int position_phase) {
+        auto indices = feature_indices(position.black, position.white);
+        std::size_t slots[feature_count];
+        double prediction = 0;
+
+        for (int i = 0; i < feature_count; i++) {
+            slots[i] = weight_offset(position_phase, i) + indices[i];
+            prediction += _weights[slots[i]];
+        }
+
+        auto error = position.score * eval_scale - prediction;
+
+        for (auto slot: slots) {
+            _gradients[slot] += error;
+            _counts[slot]++;
+        }
+
+        _totals[position_phase].positions++;
+        _totals[position_phase].squared_error += error * error;
+    }
+
+    // Moves every weight towards the average error of the positions it appeared in. The features of a position
+    // share its error, so each weight takes its part of the step.
+    void step() {
+        auto scale = _options.rate / feature_count;
+
+        for (std::size_t i = 0; i < _weights.size(); i++) {
+            if (_counts[i] != 0) {
+                _weights[i] += static_cast<float>(scale * _gradients[i] / (_counts[i] + rare_weight_count));
+            }
+        }
+    }
+
+    Options _options;
+    int _threads{1};
+    std::vector<float> _weights;
+    std::vector<double> _gradients;
+    std::vector<std::uint32_t> _counts;
+    PhaseTotals _totals[phase_count]{};
+};
+
+bool parse_options(int argc, char *argv[], Options &options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        auto option = std::string{argv[i]};
+
+        try {
+            if (option == "--positions") {
+                options.positions.emplace_back(argv[i + 1]);
+            } else if (option == "--games") {
+                options.games.emplace_back(argv[i + 1]);
+            } else if (option == "--output") {
+                options.output = argv[i + 1];
+            } else if (option == "--initial") {
+                options.initial = argv[i + 1];
+            } else if (option == "--epochs") {
+                options.epochs = std::stoi(argv[i + 1]);
+            } else if (option == "--rate") {
+                options.rate = std::stod(argv[i + 1]);
+            } else if (option == "--threads") {
+                options.threads = std::stoi(argv[i + 1]);
+            } else if (option == "--batch") {
+                options.batch = std::max<std::size_t>(std::stoul(argv[i + 1]), 1);
+            } else {
+                return false;
+            }
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    return argc % 2 == 1 && !(options.positions.empty() && options.games.empty()) && !options.output.empty();
+}
+
+int main(int argc, char *argv[]) {
+    auto options = Options{};
+
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " (--positions <path> | --games <path>)... --output <path>"
+                  << " [--initial <weights>] [--epochs <count>] [--rate <rate>] [--threads <threads>]"
+                  << " [--batch <positions>]" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<PatternEvaluator> initial;
+
+    try {
+        initial = options.initial.empty() ? std::make_unique<PatternEvaluator>()
+                                          : std::make_unique<PatternEvaluator>(options.initial);
+    } catch (const std::runtime_error &error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    auto weights = initial->weights();
+    Trainer trainer{options, std::vector<float>(weights.begin(), weights.end())};
+
+    for (int epoch = 1; epoch <= options.epochs; epoch++) {
+        auto start = std::chrono::steady_clock::now();
+
+        if (!trainer.run_epoch()) {
+            return 1;
+        }
+
+        trainer.print_epoch(epoch, std::chrono::steady_clock::now() - start);
+
+        // Written after every epoch so a long run can be stopped at any time
+        if (!write_weights(options.output, trainer.rounded_weights())) {
+            std::cerr << "Can't write " << options.output << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "transposition.h"
+
+#include <algorithm>
+#include <bit>
+
+// Packed entry layout, low bit first: 16 bits score, 8 bits depth, 2 bits bound, 7 bits best square (64 for none),
+// 8 bits generation. A zero word is an empty slot, which a real entry never packs to because its bound is set.
+
+std::uint64_t pack(const TranspositionEntry &entry, std::uint8_t generation) {
+    auto best_square = entry.best_square < 0 ? 64 : entry.best_square;
+
+    return static_cast<std::uint64_t>(static_cast<std::uint16_t>(static_cast<std::int16_t>(entry.score))) |
+           static_cast<std::uint64_t>(std::clamp(entry.depth, 0, 255)) << 16 |
+           static_cast<std::uint64_t>(entry.bound) << 24 |
+           static_cast<std::uint64_t>(best_square) << 26 |
+           static_cast<std::uint64_t>(generation) << 33;
+}
+
+TranspositionEntry unpack(std::uint64_t data) {
+    auto best_square = static_cast<int>((data >> 26) & 0x7f);
+
+    return TranspositionEntry{
+        .score = static_cast<std::int16_t>(data & 0xffff),
+        .depth = static_cast<int>((data >> 16) & 0xff),
+        .bound = static_cast<Bound>((data >> 24) & 0x3),
+        .best_square = best_square == 64 ? -1 : best_square,
+    };
+}
+
+int packed_depth(std::uint64_t data) {
+    return static_cast<int>((data >> 16) & 0xff);
+}
+
+std::uint8_t packed_generation(std::uint64_t data) {
+    return static_cast<std::uint8_t>(data >> 33);
+}
+
+
+TranspositionTable::TranspositionTable(std::size_t megabytes) {
+    auto bucket_count = std::bit_floor(std::max<std::size_t>(megabytes * 1024 * 1024 / sizeof(Bucket), 1));
+
+    _buckets = std::make_unique<Bucket[]>(bucket_count);
+    _bucket_mask = bucket_count - 1;
+}
+
+bool TranspositionTable::probe(std::uint64_t key, TranspositionEntry &entry) const {
+    const auto &bucket = _buckets[key & _bucket_mask];
+
+    for (const auto &slot: bucket.slots) {
+        auto data = slot.data.load(std::memory_order_relaxed);
+        auto checked_key = slot.checked_key.load(std::memory_order_relaxed);
+
+        if (data != 0 && (checked_key ^ data) == key) {
+            entry = unpack(data);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool TranspositionTable::store(std::uint64_t key, const TranspositionEntry &entry) {
+    auto &bucket = _buckets[key & _bucket_mask];
+    auto generation = _generation.load(std::memory_order_relaxed);
+
+    Slot *replace = nullptr;
+    auto replace_worth = 0;
+
+    for (auto &slot: bucket.slots) {
+        auto data = slot.data.load(std::memory_order_relaxed);
+        auto checked_key = slot.checked_key.load(std::memory_order_relaxed);
+
+        if (data == 0 || (checked_key ^ data) == key) {
+            replace = &slot;
+            break;
+        }
+
+        // Prefer replacing shallow entries, and entries left over from earlier searches before anything else
+        auto age = static_cast<std::uint8_t>(generation - packed_generation(data));
+        auto worth = packed_depth(data) - 8 * age;
+
+        if (replace == nullptr || worth < replace_worth) {
+            replace = &slot;
+            replace_worth = worth;
+        }
+    }
+
+    auto old_data = replace->data.load(std::memory_order_relaxed);
+    auto old_key = replace->checked_key.load(std::memory_order_relaxed) ^ old_data;
+    auto data = pack(entry, generation);
+
+    replace->checked_key.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+
+    return old_data != 0 && old_key != key;
+}
+
+void TranspositionTable::new_search() {
+    _generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    for (std::size_t i = 0; i <= _bucket_mask; i++) {
+        for (auto &slot: _buckets[i].slots) {
+            slot.checked_key.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    _hits = 0;
+    _misses = 0;
+    _stores = 0;
+    _overwrites = 0;
+}
+
+std::size_t TranspositionTable::size_bytes() const {
+    return (_bucket_mask + 1) * sizeof(Bucket);
+}
+
+void TranspositionTable::add_stats(const TranspositionStats &stats) {
+    _hits.fetch_add(stats.hits, std::memory_order_relaxed);
+    _misses.fetch_add(stats.misses, std::memory_order_relaxed);
+    _stores.fetch_add(stats.stores, std::memory_order_relaxed);
+    _overwrites.fetch_add(stats.overwrites, std::memory_order_relaxed);
+}
+
+TranspositionStats TranspositionTable::stats() const {
+    return TranspositionStats{
+        .hits = _hits.load(std::memory_order_relaxed),
+        .misses = _misses.load(std::memory_order_relaxed),
+        .stores = _stores.load(std::memory_order_relaxed),
+        .overwrites = _overwrites.load(std::memory_order_relaxed),
+    };
+}
@@ -0,0 +1,83 @@
+#ifndef REVERSI_TRANSPOSITION_H
+#define REVERSI_TRANSPOSITION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+
+enum class Bound : std::uint8_t {
+    None,
+    // Score is at most the stored score
+    Upper,
+    // Score is at least the stored score
+    Lower,
+    Exact,
+};
+
+
+struct TranspositionEntry {
+    int score{0};
+    int depth{0};
+    Bound bound{Bound::None};
+    // Best move found for the position, -1 if none
+    int best_square{-1};
+};
+
+
+struct TranspositionStats {
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t stores{0};
+    // Stores which replaced an entry for a different position
+    std::uint64_t overwrites{0};
+};
+
+
+// Fixed-size hash table shared by concurrent searches without locks. Each entry is two 64-bit words, the packed
+// entry and the key xor-ed with it, so a torn read from a racing write fails verification and reads as a miss.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(std::size_t megabytes);
+
+    [[nodiscard]] bool probe(std::uint64_t key, TranspositionEntry &entry) const;
+
+    // Returns true if an entry for another position was replaced
+    bool store(std::uint64_t key, const TranspositionEntry &entry);
+
+    // Starts a new search, entries of older searches are replaced first
+    void new_search();
+
+    void clear();
+
+    [[nodiscard]] std::size_t size_bytes() const;
+
+    // Counters are collected by each search locally and added once it finishes, to keep shared cache lines quiet
+    void add_stats(const TranspositionStats &stats);
+
+    [[nodiscard]] TranspositionStats stats() const;
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> checked_key{0};
+        std::atomic<std::uint64_t> data{0};
+    };
+
+    static constexpr int slots_per_bucket = 4;
+
+    struct alignas(64) Bucket {
+        Slot slots[slots_per_bucket];
+    };
+
+    std::unique_ptr<Bucket[]> _buckets;
+    std::size_t _bucket_mask{0};
+    std::atomic<std::uint8_t> _generation{0};
+
+    std::atomic<std::uint64_t> _hits{0};
+    std::atomic<std::uint64_t> _misses{0};
+    std::atomic<std::uint64_t> _stores{0};
+    std::atomic<std::uint64_t> _overwrites{0};
+};
+
+#endif //REVERSI_TRANSPOSITION_H